@@ -0,0 +1,252 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "anim.h"
+#include "vbe.h"
+
+/*
+ * Returns true if the pixel is of the transparent color
+ */
+static inline bool is_colorkey(const uint8_t *p, uint8_t pixel_size, uint32_t colorkey) {
+    switch (pixel_size) {
+        case 1: return *p == (uint8_t) colorkey;
+        case 2: return *(const uint16_t *) p == (uint16_t) colorkey;
+        case 4: return *(const uint32_t *) p == colorkey;
+        default: return memcmp(p, &colorkey, pixel_size) == 0;
+    }
+}
+
+/*
+ * Returns true if any of the count pixels starting at p is opaque
+ */
+static bool any_opaque(const uint8_t *p, size_t step, uint16_t count, uint8_t pixel_size, uint32_t colorkey) {
+    for (uint16_t i = 0; i < count; i++, p += step)
+        if (!is_colorkey(p, pixel_size, colorkey))
+            return true;
+    return false;
+}
+
+/*
+ * Shrinks the source rectangle of a frame to the rows and columns holding opaque pixels
+ */
+static void find_opaque_bounds(const sprite_sheet *sheet, sprite_frame *frame) {
+
+    const surface_t *s = &sheet->pixels;
+    const sprite_rect *src = &frame->source;
+    uint8_t ps = s->pixel_size;
+
+    /* Rows first, then the columns only need to be scanned between them */
+    int32_t top = 0, bottom = src->height;
+    while (top < bottom && !any_opaque(surface_at(s, src->x, src->y + top), ps, src->width, ps, sheet->colorkey))
+        top++;
+    while (bottom > top && !any_opaque(surface_at(s, src->x, src->y + bottom - 1), ps, src->width, ps, sheet->colorkey))
+        bottom--;
+
+    /* A fully transparent frame covers nothing */
+    if (top == bottom) {
+        frame->opaque = (sprite_rect) {0, 0, 0, 0};
+        return;
+    }
+
+    int32_t left = 0, right = src->width;
+    while (left < right && !any_opaque(surface_at(s, src->x + left, src->y + top), s->pitch, bottom - top, ps, sheet->colorkey))
+        left++;
+    while (right > left && !any_opaque(surface_at(s, src->x + right - 1, src->y + top), s->pitch, bottom - top, ps, sheet->colorkey))
+        right--;
+
+    frame->opaque.x = left;
+    frame->opaque.y = top;
+    frame->opaque.width = right - left;
+    frame->opaque.height = bottom - top;
+}
+
+int sprite_sheet_init(sprite_sheet *sheet, const surface_t *pixels, uint32_t colorkey) {
+
+    if (sheet == NULL || pixels == NULL) {
+        printf("(%s) Invalid sheet or pixels\n", __func__);
+        return ANIM_INVALID_ARGS;
+    }
+
+    sheet->pixels = *pixels;
+    sheet->colorkey = colorkey;
+    sheet->frames = NULL;
+    sheet->frame_count = sheet->frame_capacity = 0;
+    return ANIM_OK;
+}
+
+void sprite_sheet_free(sprite_sheet *sheet) {
+    free(sheet->frames);
+    sheet->frames = NULL;
+    sheet->frame_count = sheet->frame_capacity = 0;
+}
+
+int sprite_sheet_add_frame(sprite_sheet *sheet, const sprite_rect *source, int16_t pivot_x, int16_t pivot_y, uint16_t ticks) {
+
+    if (source->x < 0 || source->y < 0 || source->width == 0 || source->height == 0 ||
+        source->x + source->width > sheet->pixels.width || source->y + source->height > sheet->pixels.height || ticks == 0) {
+        printf("(%s) Invalid frame\n", __func__);
+        return -ANIM_INVALID_ARGS;
+    }
+
+    /* Grow the frames array when full */
+    if (sheet->frame_count == sheet->frame_capacity) {
+        uint16_t capacity = (sheet->frame_capacity ? 2 * sheet->frame_capacity : SHEET_FRAMES_INITIAL);
+        sprite_frame *frames = realloc(sheet->frames, capacity * sizeof(sprite_frame));
+        if (frames == NULL) {
+            printf("(%s) Couldnt grow the frames array\n", __func__);
+            return -ANIM_ALLOC_FAILED;
+        }
+        sheet->frames = frames;
+        sheet->frame_capacity = capacity;
+    }
+
+    sprite_frame *frame = &sheet->frames[sheet->frame_count];
+    frame->source = *source;
+    frame->pivot_x = pivot_x;
+    frame->pivot_y = pivot_y;
+    frame->ticks = ticks;
+    find_opaque_bounds(sheet, frame);
+
+    return sheet->frame_count++;
+}
+
+int sprite_sheet_add_grid(sprite_sheet *sheet, uint16_t frame_width, uint16_t frame_height, int16_t pivot_x, int16_t pivot_y, uint16_t ticks) {
+
+    if (frame_width == 0 || frame_height == 0 || frame_width > sheet->pixels.width || frame_height > sheet->pixels.height) {
+        printf("(%s) Invalid frame size\n", __func__);
+        return -ANIM_INVALID_ARGS;
+    }
+
+    int first = sheet->frame_count;
+    sprite_rect source = {0, 0, frame_width, frame_height};
+
+    for (source.y = 0; source.y + frame_height <= sheet->pixels.height; source.y += frame_height) {
+        for (source.x = 0; source.x + frame_width <= sheet->pixels.width; source.x += frame_width) {
+            int res = sprite_sheet_add_frame(sheet, &source, pivot_x, pivot_y, ticks);
+            if (res < 0)
+                return res;
+        }
+    }
+
+    return first;
+}
+
+void sprite_frame_bounds(const sprite_sheet *sheet, uint16_t frame, int16_t x, int16_t y, sprite_rect *rect) {
+    const sprite_frame *f = &sheet->frames[frame];
+    rect->x = x - f->pivot_x + f->opaque.x;
+    rect->y = y - f->pivot_y + f->opaque.y;
+    rect->width = f->opaque.width;
+    rect->height = f->opaque.height;
+}
+
+int draw_sprite_frame_on(const sprite_sheet *sheet, uint16_t frame, int16_t x, int16_t y, surface_t *surface) {
+
+    if (frame >= sheet->frame_count) {
+        printf("(%s) Invalid frame: %d\n", __func__, frame);
+        return ANIM_INVALID_ARGS;
+    }
+
+    const surface_t *s = &sheet->pixels;
+    uint8_t ps = s->pixel_size;
+    if (ps != surface->pixel_size) {
+        printf("(%s) The sheet and the surface have different pixel sizes\n", __func__);
+        return ANIM_FORMAT_MISMATCH;
+    }
+
+    /* Clip the opaque bounds to the surface */
+    const sprite_frame *f = &sheet->frames[frame];
+    sprite_rect dst;
+    sprite_frame_bounds(sheet, frame, x, y, &dst);
+
+    int32_t first_col = (dst.x < 0 ? -dst.x : 0), first_row = (dst.y < 0 ? -dst.y : 0);
+    int32_t cols = (dst.x + dst.width > surface->width ? surface->width - dst.x : dst.width) - first_col;
+    int32_t rows = (dst.y + dst.height > surface->height ? surface->height - dst.y : dst.height) - first_row;
+    if (cols <= 0 || rows <= 0)
+        return ANIM_OK;
+
+    int32_t src_x = f->source.x + f->opaque.x + first_col, src_y = f->source.y + f->opaque.y + first_row;
+
+    for (int32_t i = 0; i < rows; i++) {
+        const uint8_t *from = surface_at(s, src_x, src_y + i);
+        uint8_t *to = surface_at(surface, dst.x + first_col, dst.y + first_row + i);
+
+        /* Copy each run of opaque pixels at once */
+        int32_t j = 0;
+        while (j < cols) {
+            while (j < cols && is_colorkey(from + j * ps, ps, sheet->colorkey))
+                j++;
+            int32_t run = j;
+            while (j < cols && !is_colorkey(from + j * ps, ps, sheet->colorkey))
+                j++;
+            memcpy(to + run * ps, from + run * ps, (size_t) (j - run) * ps);
+        }
+    }
+
+    vg_target_modified(surface->pixels);
+    return ANIM_OK;
+}
+
+int animation_start(animation *anim, const sprite_sheet *sheet, uint16_t first, uint16_t count, bool loop, uint32_t now) {
+
+    if (anim == NULL || sheet == NULL || count == 0 || first + count > sheet->frame_count) {
+        printf("(%s) Invalid frames: %d to %d\n", __func__, first, first + count - 1);
+        return ANIM_INVALID_ARGS;
+    }
+
+    anim->sheet = sheet;
+    anim->first = first;
+    anim->count = count;
+    anim->loop = loop;
+    anim->current = 0;
+    anim->frame_start = now;
+    anim->finished = false;
+
+    anim->length = 0;
+    for (uint16_t i = 0; i < count; i++)
+        anim->length += sheet->frames[first + i].ticks;
+
+    return ANIM_OK;
+}
+
+bool animation_update(animation *anim, uint32_t now) {
+
+    if (anim->finished)
+        return false;
+
+    const sprite_frame *frames = anim->sheet->frames + anim->first;
+    uint16_t previous = anim->current;
+    uint32_t elapsed = now - anim->frame_start;
+
+    /* After a long pause, whole runs through the frames are skipped at once */
+    if (anim->loop && elapsed >= anim->length) {
+        anim->frame_start += elapsed - elapsed % anim->length;
+        elapsed %= anim->length;
+    }
+
+    while (elapsed >= frames[anim->current].ticks) {
+        uint16_t ticks = frames[anim->current].ticks;
+
+        if (anim->current + 1 == anim->count) {
+            /* Stay on the last frame */
+            if (!anim->loop) {
+                anim->finished = true;
+                break;
+            }
+            anim->current = 0;
+        }
+        else
+            anim->current++;
+
+        anim->frame_start += ticks;
+        elapsed -= ticks;
+    }
+
+    return anim->current != previous;
+}
+
+uint16_t animation_frame(const animation *anim) {
+    return anim->first + anim->current;
+}
+
+int draw_animation_on(const animation *anim, int16_t x, int16_t y, surface_t *surface) {
+    return draw_sprite_frame_on(anim->sheet, animation_frame(anim), x, y, surface);
+}
@@ -0,0 +1,177 @@
+/*
+ * This file contains the sprite sheets and their timed playback.
+ * Every frame of an animation is a rectangle of one sheet, whose opaque
+ * bounds are found once so drawing and clearing skip the transparent border.
+ */
+#ifndef ANIM_H
+#define ANIM_H
+
+#include <lcom/lcf.h>
+#include "vbe.h"
+
+/* Frames preallocated for a sheet, grown by doubling when needed */
+#define SHEET_FRAMES_INITIAL 8
+
+/* Rectangle in pixels */
+typedef struct {
+    int16_t x, y;
+    uint16_t width, height;
+} sprite_rect;
+
+/* One frame of a sprite sheet */
+typedef struct {
+    sprite_rect source; /* Rectangle of the sheet holding the frame */
+    int16_t pivot_x, pivot_y; /* Point of the frame placed at the drawing position, relative to source */
+    uint16_t ticks; /* Timer interrupts the frame is shown for */
+    sprite_rect opaque; /* Smallest rectangle holding every opaque pixel, relative to source */
+} sprite_frame;
+
+/* Image holding every frame of one or more animations */
+typedef struct {
+    surface_t pixels; /* The whole sheet */
+    uint32_t colorkey; /* Pixels of this color are transparent */
+    sprite_frame *frames;
+    uint16_t frame_count, frame_capacity;
+} sprite_sheet;
+
+/* Playback state of a run of consecutive frames of a sheet */
+typedef struct {
+    const sprite_sheet *sheet;
+    uint16_t first, count; /* Frames of the sheet that are played */
+    bool loop; /* Whether to start over after the last frame, or stay on it */
+    uint16_t current; /* Frame being shown, counted from first */
+    uint32_t frame_start; /* Timer interrupt count when the current frame started */
+    uint32_t length; /* Timer interrupts of a whole run through the frames */
+    bool finished; /* Whether a non looping animation reached its last frame */
+} animation;
+
+/**
+ * @brief Initializes a sprite sheet without frames
+ * 
+ * The sheet keeps pointing to the pixels, which must stay valid while it is used
+ * 
+ * @param sheet Address of memory to be initialized
+ * @param pixels Surface holding the frames, in the format of the surfaces they are drawn to
+ * @param colorkey Color of the transparent pixels, in the sheet's pixel format
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int sprite_sheet_init(sprite_sheet *sheet, const surface_t *pixels, uint32_t colorkey);
+
+/**
+ * @brief Frees the frames of a sprite sheet, the pixels stay with the caller
+ * 
+ * @param sheet Sheet to free
+ */
+void sprite_sheet_free(sprite_sheet *sheet);
+
+/**
+ * @brief Adds a frame to a sprite sheet, finding its opaque bounds
+ * 
+ * @param sheet Sheet to add to
+ * @param source Rectangle of the sheet holding the frame, must be inside it
+ * @param pivot_x Point of the frame placed at the drawing position, along the x axis
+ * @param pivot_y Point of the frame placed at the drawing position, along the y axis
+ * @param ticks Timer interrupts the frame is shown for
+ * @return Index of the new frame, negative upon failure
+ */
+int sprite_sheet_add_frame(sprite_sheet *sheet, const sprite_rect *source, int16_t pivot_x, int16_t pivot_y, uint16_t ticks);
+
+/**
+ * @brief Adds the frames of a sheet laid out as a grid, row by row
+ * 
+ * @param sheet Sheet to add to
+ * @param frame_width Size in pixels of every frame along the x axis
+ * @param frame_height Size in pixels of every frame along the y axis
+ * @param pivot_x Point of every frame placed at the drawing position, along the x axis
+ * @param pivot_y Point of every frame placed at the drawing position, along the y axis
+ * @param ticks Timer interrupts each frame is shown for
+ * @return Index of the first new frame, negative upon failure
+ */
+int sprite_sheet_add_grid(sprite_sheet *sheet, uint16_t frame_width, uint16_t frame_height, int16_t pivot_x, int16_t pivot_y, uint16_t ticks);
+
+/**
+ * @brief Returns the rectangle a frame covers when drawn at a position
+ * 
+ * Only the opaque bounds are covered, so this is all that has to be cleared afterwards
+ * 
+ * @param sheet Sheet holding the frame
+ * @param frame Index of the frame
+ * @param x Coordinate the pivot is placed at along the x axis
+ * @param y Coordinate the pivot is placed at along the y axis
+ * @param rect Address of memory to be initialized with the covered rectangle
+ */
+void sprite_frame_bounds(const sprite_sheet *sheet, uint16_t frame, int16_t x, int16_t y, sprite_rect *rect);
+
+/**
+ * @brief Draws a frame of a sprite sheet with its pivot at the given position
+ * 
+ * Only the opaque bounds are visited, and pixels of the colorkey are left untouched
+ * 
+ * @param sheet Sheet holding the frame
+ * @param frame Index of the frame
+ * @param x Coordinate the pivot is placed at along the x axis, may be off the surface
+ * @param y Coordinate the pivot is placed at along the y axis, may be off the surface
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_sprite_frame_on(const sprite_sheet *sheet, uint16_t frame, int16_t x, int16_t y, surface_t *surface);
+
+/**
+ * @brief Starts playing a run of consecutive frames of a sheet
+ * 
+ * @param anim Address of memory to be initialized
+ * @param sheet Sheet holding the frames
+ * @param first Index of the first frame
+ * @param count Number of frames
+ * @param loop Whether to start over after the last frame
+ * @param now Current timer interrupt count
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int animation_start(animation *anim, const sprite_sheet *sheet, uint16_t first, uint16_t count, bool loop, uint32_t now);
+
+/**
+ * @brief Advances an animation to the given time
+ * 
+ * May skip several frames if it was not updated for a while
+ * 
+ * @param anim Animation to advance
+ * @param now Current timer interrupt count
+ * @return True if the frame shown changed
+ */
+bool animation_update(animation *anim, uint32_t now);
+
+/**
+ * @brief Returns the frame of the sheet an animation is showing
+ * 
+ * @param anim Animation to query
+ * @return Index of the frame in the sheet
+ */
+uint16_t animation_frame(const animation *anim);
+
+/**
+ * @brief Draws the frame an animation is showing, with its pivot at the given position
+ * 
+ * @param anim Animation to draw
+ * @param x Coordinate the pivot is placed at along the x axis, may be off the surface
+ * @param y Coordinate the pivot is placed at along the y axis, may be off the surface
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_animation_on(const animation *anim, int16_t x, int16_t y, surface_t *surface);
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease debugging.
+ */
+typedef enum _anim_status {
+    /* operation was successful */
+    ANIM_OK = OK,
+    /* invalid arguments */
+    ANIM_INVALID_ARGS,
+    /* the sheet and the target have different pixel sizes */
+    ANIM_FORMAT_MISMATCH,
+    /* failed allocating memory */
+    ANIM_ALLOC_FAILED
+} anim_status;
+
+#endif /* end of include guard: ANIM_H */
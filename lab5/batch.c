@@ -0,0 +1,151 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "batch.h"
+#include "anim.h"
+#include "vbe.h"
+#include "util.h"
+
+/*
+ * Reallocates every buffer of a batch to the given capacity
+ */
+static int sprite_batch_reserve(sprite_batch *batch, uint32_t capacity) {
+
+    void **arrays[] = {(void **) &batch->sprites, (void **) &batch->keys, (void **) &batch->keys_tmp, (void **) &batch->order, (void **) &batch->order_tmp};
+    static const size_t element_sizes[] = {sizeof(sprite_instance), sizeof(uint16_t), sizeof(uint16_t), sizeof(uint32_t), sizeof(uint32_t)};
+
+    if (!grow_arrays(arrays, element_sizes, sizeof(element_sizes) / sizeof(element_sizes[0]), capacity)) {
+        printf("(%s) Couldnt grow the batch to %u sprites\n", __func__, capacity);
+        return BATCH_ALLOC_FAILED;
+    }
+
+    batch->capacity = capacity;
+    return BATCH_OK;
+}
+
+int sprite_batch_init(sprite_batch *batch) {
+
+    if (batch == NULL) {
+        printf("(%s) Invalid batch\n", __func__);
+        return BATCH_INVALID_ARGS;
+    }
+
+    memset(batch, 0, sizeof(sprite_batch));
+    return sprite_batch_reserve(batch, BATCH_INITIAL);
+}
+
+void sprite_batch_free(sprite_batch *batch) {
+    free(batch->sprites);
+    free(batch->keys);
+    free(batch->keys_tmp);
+    free(batch->order);
+    free(batch->order_tmp);
+    memset(batch, 0, sizeof(sprite_batch));
+}
+
+void sprite_batch_begin(sprite_batch *batch) {
+    batch->count = 0;
+}
+
+int sprite_batch_add(sprite_batch *batch, const sprite_sheet *sheet, uint16_t frame, int16_t x, int16_t y, uint16_t depth) {
+
+    if (sheet == NULL || frame >= sheet->frame_count) {
+        printf("(%s) Invalid sheet or frame\n", __func__);
+        return BATCH_INVALID_ARGS;
+    }
+
+    if (batch->count == batch->capacity && sprite_batch_reserve(batch, 2 * batch->capacity) != BATCH_OK)
+        return BATCH_ALLOC_FAILED;
+
+    sprite_instance *s = &batch->sprites[batch->count++];
+    s->sheet = sheet;
+    s->frame = frame;
+    s->x = x;
+    s->y = y;
+    s->depth = depth;
+    return BATCH_OK;
+}
+
+int sprite_batch_draw(sprite_batch *batch, surface_t *surface) {
+
+    if (batch == NULL || surface == NULL) {
+        printf("(%s) Invalid batch or surface\n", __func__);
+        return BATCH_INVALID_ARGS;
+    }
+
+    /* Keep only the sprites whose opaque bounds reach the surface, and that can be copied to it */
+    uint32_t visible = 0, mismatched = 0;
+    for (uint32_t i = 0; i < batch->count; i++) {
+        const sprite_instance *s = &batch->sprites[i];
+        if (s->sheet->pixels.pixel_size != surface->pixel_size) {
+            mismatched++;
+            continue;
+        }
+
+        sprite_rect r;
+        sprite_frame_bounds(s->sheet, s->frame, s->x, s->y, &r);
+
+        if (r.width == 0 || r.height == 0 || r.x >= surface->width || r.y >= surface->height ||
+            r.x + r.width <= 0 || r.y + r.height <= 0)
+            continue;
+
+        batch->keys[visible] = s->depth;
+        batch->order[visible] = i;
+        visible++;
+    }
+
+    /*
+     * Least significant digit radix sort on the depths. Each pass is stable,
+     * so sprites of the same depth keep the order they were queued in.
+     */
+    uint16_t *keys = batch->keys, *keys_tmp = batch->keys_tmp;
+    uint32_t *order = batch->order, *order_tmp = batch->order_tmp;
+
+    for (uint8_t pass = 0; pass < BATCH_RADIX_PASSES; pass++) {
+        uint8_t shift = pass * BATCH_RADIX_BITS;
+        uint32_t offsets[BATCH_RADIX_SIZE] = {0};
+
+        for (uint32_t i = 0; i < visible; i++)
+            offsets[(keys[i] >> shift) & (BATCH_RADIX_SIZE - 1)]++;
+
+        /* Nothing moves if every key has the same digit, as with few distinct depths */
+        if (visible == 0 || offsets[(keys[0] >> shift) & (BATCH_RADIX_SIZE - 1)] == visible)
+            continue;
+
+        uint32_t sum = 0;
+        for (uint32_t d = 0; d < BATCH_RADIX_SIZE; d++) {
+            uint32_t count = offsets[d];
+            offsets[d] = sum;
+            sum += count;
+        }
+
+        for (uint32_t i = 0; i < visible; i++) {
+            uint32_t dst = offsets[(keys[i] >> shift) & (BATCH_RADIX_SIZE - 1)]++;
+            keys_tmp[dst] = keys[i];
+            order_tmp[dst] = order[i];
+        }
+
+        uint16_t *k = keys; keys = keys_tmp; keys_tmp = k;
+        uint32_t *o = order; order = order_tmp; order_tmp = o;
+    }
+
+    /* Back to front, every sprite is drawn straight from its sheet */
+    uint32_t drawn = 0;
+    for (uint32_t i = 0; i < visible; i++) {
+        const sprite_instance *s = &batch->sprites[order[i]];
+        if (draw_sprite_frame_on(s->sheet, s->frame, s->x, s->y, surface) == ANIM_OK)
+            drawn++;
+    }
+
+    batch->drawn = drawn;
+    batch->culled = batch->count - visible - mismatched;
+
+    if (mismatched > 0) {
+        printf("(%s) %u sprites have a different pixel size than the surface\n", __func__, mismatched);
+        return BATCH_FORMAT_MISMATCH;
+    }
+    if (drawn != visible) {
+        printf("(%s) %u sprites couldnt be drawn\n", __func__, visible - drawn);
+        return BATCH_DRAW_FAILED;
+    }
+    return BATCH_OK;
+}
@@ -0,0 +1,103 @@
+/*
+ * This file contains the sprite batch: sprite frames queued during a frame,
+ * culled against the target and drawn back to front in a single pass.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <lcom/lcf.h>
+#include "vbe.h"
+#include "anim.h"
+
+/* Sprites preallocated for a batch, grown by doubling when needed */
+#define BATCH_INITIAL 1024
+
+/* Depths are sorted 8 bits per pass, least significant first */
+#define BATCH_RADIX_BITS 8
+#define BATCH_RADIX_SIZE (1 << BATCH_RADIX_BITS)
+#define BATCH_RADIX_PASSES (16 / BATCH_RADIX_BITS)
+
+/* Sprite queued for drawing */
+typedef struct {
+    const sprite_sheet *sheet;
+    uint16_t frame; /* Index of the frame in the sheet */
+    int16_t x, y; /* Coordinates the pivot is placed at */
+    uint16_t depth; /* Sprites of greater depth are drawn over the others */
+} sprite_instance;
+
+/* Sprites queued for a frame, and the buffers used to sort them */
+typedef struct {
+    sprite_instance *sprites;
+    uint32_t count, capacity;
+    uint16_t *keys, *keys_tmp; /* Depths of the visible sprites, in sorting order */
+    uint32_t *order, *order_tmp; /* Indices of the visible sprites, in sorting order */
+    uint32_t drawn, culled; /* Outcome of the last draw, sprites that failed to draw are in neither */
+} sprite_batch;
+
+/**
+ * @brief Initializes an empty sprite batch
+ * 
+ * @param batch Address of memory to be initialized
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int sprite_batch_init(sprite_batch *batch);
+
+/**
+ * @brief Frees the buffers of a sprite batch
+ * 
+ * @param batch Batch to free
+ */
+void sprite_batch_free(sprite_batch *batch);
+
+/**
+ * @brief Removes every queued sprite, keeping the buffers for the next frame
+ * 
+ * @param batch Batch to clear
+ */
+void sprite_batch_begin(sprite_batch *batch);
+
+/**
+ * @brief Queues a frame of a sprite sheet for drawing
+ * 
+ * Sprites of the same depth are drawn in the order they were queued
+ * 
+ * @param batch Batch to add to
+ * @param sheet Sheet holding the frame, must stay valid until the batch is drawn
+ * @param frame Index of the frame
+ * @param x Coordinate the pivot is placed at along the x axis
+ * @param y Coordinate the pivot is placed at along the y axis
+ * @param depth Sprites of greater depth are drawn over the others
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int sprite_batch_add(sprite_batch *batch, const sprite_sheet *sheet, uint16_t frame, int16_t x, int16_t y, uint16_t depth);
+
+/**
+ * @brief Draws the queued sprites that are visible on a surface, back to front
+ * 
+ * Sprites whose opaque bounds are off the surface are skipped before sorting.
+ * Sprites from sheets of another pixel size are skipped too, the others still drawn.
+ * 
+ * @param batch Batch to draw
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero if any sprite could not be drawn
+ */
+int sprite_batch_draw(sprite_batch *batch, surface_t *surface);
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease debugging.
+ */
+typedef enum _batch_status {
+    /* operation was successful */
+    BATCH_OK = OK,
+    /* invalid arguments */
+    BATCH_INVALID_ARGS,
+    /* failed allocating memory */
+    BATCH_ALLOC_FAILED,
+    /* sheet and surface have different pixel sizes */
+    BATCH_FORMAT_MISMATCH,
+    /* failed drawing a sprite */
+    BATCH_DRAW_FAILED
+} batch_status;
+
+#endif /* end of include guard: BATCH_H */
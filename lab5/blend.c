@@ -0,0 +1,326 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "blend.h"
+#include "vbe.h"
+#include "util.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+typedef void (*blend_span_t)(uint8_t *dst, const uint32_t *argb, size_t count);
+typedef void (*blend_span_const_t)(uint8_t *dst, const uint8_t *src, size_t count, uint8_t alpha);
+
+static blend_span_t span_alpha = NULL;
+static blend_span_const_t span_const = NULL;
+
+/* Layout of the mode's pixels, used by the scalar kernels */
+static uint8_t pixel_size;
+static uint8_t field_position[3], mask_size[3];
+static uint8_t expand_lut[3][256]; /* Channel value to 8 bits */
+
+/*
+ * Exact rounded (a * alpha + b * (255 - alpha)) / 255
+ */
+static inline uint8_t mix(uint8_t a, uint8_t b, uint8_t alpha) {
+    uint32_t t = a * alpha + b * (ALPHA_OPAQUE - alpha) + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+/*
+ * Blends 8 bit components onto a pixel of any direct color layout
+ */
+static void blend_pixel_generic(uint8_t *dst, const uint8_t src[3], uint8_t alpha) {
+    uint32_t pixel = 0, result = 0;
+    memcpy(&pixel, dst, pixel_size);
+
+    for (uint8_t c = 0; c < 3; c++) {
+        uint32_t mask = set_bits_mask(mask_size[c]);
+        uint8_t value = mix(src[c], expand_lut[c][(pixel >> field_position[c]) & mask], alpha);
+        result |= (uint32_t) (value >> (BYTE_SIZE - mask_size[c])) << field_position[c];
+    }
+
+    memcpy(dst, &result, pixel_size);
+}
+
+static void blend_argb_generic(uint8_t *dst, const uint32_t *argb, size_t count) {
+    for (size_t i = 0; i < count; i++, dst += pixel_size) {
+        uint8_t alpha = argb[i] >> ALPHA_SHIFT;
+        if (alpha == ALPHA_TRANSPARENT)
+            continue;
+
+        uint8_t src[3] = {argb[i] >> 16, argb[i] >> 8, argb[i]};
+        blend_pixel_generic(dst, src, alpha);
+    }
+}
+
+static void blend_const_generic(uint8_t *dst, const uint8_t *src, size_t count, uint8_t alpha) {
+    for (size_t i = 0; i < count; i++, dst += pixel_size, src += pixel_size) {
+        uint32_t pixel = 0;
+        memcpy(&pixel, src, pixel_size);
+
+        uint8_t components[3];
+        for (uint8_t c = 0; c < 3; c++)
+            components[c] = expand_lut[c][(pixel >> field_position[c]) & set_bits_mask(mask_size[c])];
+        blend_pixel_generic(dst, components, alpha);
+    }
+}
+
+/*
+ * 32 bit ARGB, 8 bits per component
+ */
+static inline uint32_t blend_argb32_pixel(uint32_t dst, uint32_t src, uint8_t alpha) {
+    return ((uint32_t) mix(src >> 16, dst >> 16, alpha) << 16) |
+           ((uint32_t) mix(src >> 8, dst >> 8, alpha) << 8) |
+           mix(src, dst, alpha);
+}
+
+#ifdef __SSE2__
+/*
+ * Blends 16 bit lanes holding 8 bit values: (s * a + d * (255 - a)) / 255, rounded
+ */
+static inline __m128i mix_epi16(__m128i s, __m128i d, __m128i a) {
+    const __m128i c255 = _mm_set1_epi16(ALPHA_OPAQUE);
+    const __m128i c128 = _mm_set1_epi16(128);
+
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, _mm_sub_epi16(c255, a)));
+    t = _mm_add_epi16(t, c128);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+/*
+ * Spreads the alpha word of each of the two pixels in v to all of its 4 words
+ */
+static inline __m128i broadcast_alpha(__m128i v) {
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+#endif
+
+static void blend_argb32(uint8_t *dst8, const uint32_t *argb, size_t count) {
+    uint32_t *dst = (uint32_t *) dst8;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32((int) ((uint32_t) ALPHA_OPAQUE << ALPHA_SHIFT));
+
+    /* 4 pixels per iteration */
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *) (argb + i));
+        __m128i alpha = _mm_and_si128(s, alpha_mask);
+
+        /* Fully transparent or fully opaque groups need no math */
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF)
+            continue;
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_mask)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i *) (dst + i), s);
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128((const __m128i *) (dst + i));
+        __m128i s_lo = _mm_unpacklo_epi8(s, zero), s_hi = _mm_unpackhi_epi8(s, zero);
+        __m128i d_lo = _mm_unpacklo_epi8(d, zero), d_hi = _mm_unpackhi_epi8(d, zero);
+
+        __m128i lo = mix_epi16(s_lo, d_lo, broadcast_alpha(s_lo));
+        __m128i hi = mix_epi16(s_hi, d_hi, broadcast_alpha(s_hi));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < count; i++) {
+        uint8_t alpha = argb[i] >> ALPHA_SHIFT;
+        if (alpha != ALPHA_TRANSPARENT)
+            dst[i] = blend_argb32_pixel(dst[i], argb[i], alpha);
+    }
+}
+
+static void blend_const32(uint8_t *dst8, const uint8_t *src8, size_t count, uint8_t alpha) {
+    uint32_t *dst = (uint32_t *) dst8;
+    const uint32_t *src = (const uint32_t *) src8;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i a = _mm_set1_epi16(alpha);
+
+    /* 4 pixels per iteration */
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+        __m128i d = _mm_loadu_si128((const __m128i *) (dst + i));
+
+        __m128i lo = mix_epi16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), a);
+        __m128i hi = mix_epi16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), a);
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < count; i++)
+        dst[i] = blend_argb32_pixel(dst[i], src[i], alpha);
+}
+
+/*
+ * 16 bit 565, components widened to 8 bits for blending
+ */
+static inline uint16_t blend_565_pixel(uint16_t dst, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha) {
+    uint8_t dst_red = (dst >> 11) & 0x1F, dst_green = (dst >> 5) & 0x3F, dst_blue = dst & 0x1F;
+
+    red = mix(red, (dst_red << 3) | (dst_red >> 2), alpha);
+    green = mix(green, (dst_green << 2) | (dst_green >> 4), alpha);
+    blue = mix(blue, (dst_blue << 3) | (dst_blue >> 2), alpha);
+
+    return ((uint16_t) (red >> 3) << 11) | ((uint16_t) (green >> 2) << 5) | (blue >> 3);
+}
+
+#ifdef __SSE2__
+/*
+ * Splits 8 565 pixels into 8 bit red, green and blue in 16 bit lanes
+ */
+static inline void unpack_565(__m128i p, __m128i *red, __m128i *green, __m128i *blue) {
+    const __m128i mask5 = _mm_set1_epi16(0x1F), mask6 = _mm_set1_epi16(0x3F);
+
+    __m128i r = _mm_srli_epi16(p, 11);
+    __m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask6);
+    __m128i b = _mm_and_si128(p, mask5);
+
+    *red = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+    *green = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+    *blue = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+}
+
+/*
+ * Packs 8 bit red, green and blue in 16 bit lanes into 8 565 pixels
+ */
+static inline __m128i pack_565(__m128i red, __m128i green, __m128i blue) {
+    return _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(red, 3), 11),
+                                     _mm_slli_epi16(_mm_srli_epi16(green, 2), 5)),
+                        _mm_srli_epi16(blue, 3));
+}
+#endif
+
+static void blend_argb_565(uint8_t *dst8, const uint32_t *argb, size_t count) {
+    uint16_t *dst = (uint16_t *) dst8;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i byte_mask = _mm_set1_epi32(0xFF);
+    const __m128i zero = _mm_setzero_si128();
+
+    /* 8 pixels per iteration, ARGB components narrowed to 16 bit lanes */
+    for (; i + 8 <= count; i += 8) {
+        __m128i s0 = _mm_loadu_si128((const __m128i *) (argb + i));
+        __m128i s1 = _mm_loadu_si128((const __m128i *) (argb + i + 4));
+
+        __m128i alpha = _mm_packs_epi32(_mm_srli_epi32(s0, ALPHA_SHIFT), _mm_srli_epi32(s1, ALPHA_SHIFT));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(alpha, zero)) == 0xFFFF)
+            continue;
+
+        __m128i red = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, 16), byte_mask), _mm_and_si128(_mm_srli_epi32(s1, 16), byte_mask));
+        __m128i green = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, 8), byte_mask), _mm_and_si128(_mm_srli_epi32(s1, 8), byte_mask));
+        __m128i blue = _mm_packs_epi32(_mm_and_si128(s0, byte_mask), _mm_and_si128(s1, byte_mask));
+
+        __m128i dst_red, dst_green, dst_blue;
+        unpack_565(_mm_loadu_si128((const __m128i *) (dst + i)), &dst_red, &dst_green, &dst_blue);
+
+        __m128i result = pack_565(mix_epi16(red, dst_red, alpha), mix_epi16(green, dst_green, alpha), mix_epi16(blue, dst_blue, alpha));
+        _mm_storeu_si128((__m128i *) (dst + i), result);
+    }
+#endif
+
+    for (; i < count; i++) {
+        uint8_t alpha = argb[i] >> ALPHA_SHIFT;
+        if (alpha != ALPHA_TRANSPARENT)
+            dst[i] = blend_565_pixel(dst[i], argb[i] >> 16, argb[i] >> 8, argb[i], alpha);
+    }
+}
+
+static void blend_const_565(uint8_t *dst8, const uint8_t *src8, size_t count, uint8_t alpha) {
+    uint16_t *dst = (uint16_t *) dst8;
+    const uint16_t *src = (const uint16_t *) src8;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i a = _mm_set1_epi16(alpha);
+
+    /* 8 pixels per iteration */
+    for (; i + 8 <= count; i += 8) {
+        __m128i red, green, blue, dst_red, dst_green, dst_blue;
+        unpack_565(_mm_loadu_si128((const __m128i *) (src + i)), &red, &green, &blue);
+        unpack_565(_mm_loadu_si128((const __m128i *) (dst + i)), &dst_red, &dst_green, &dst_blue);
+
+        __m128i result = pack_565(mix_epi16(red, dst_red, a), mix_epi16(green, dst_green, a), mix_epi16(blue, dst_blue, a));
+        _mm_storeu_si128((__m128i *) (dst + i), result);
+    }
+#endif
+
+    for (; i < count; i++) {
+        uint8_t red = (src[i] >> 11) & 0x1F, green = (src[i] >> 5) & 0x3F, blue = src[i] & 0x1F;
+        dst[i] = blend_565_pixel(dst[i], (red << 3) | (red >> 2), (green << 2) | (green >> 4), (blue << 3) | (blue >> 2), alpha);
+    }
+}
+
+int blend_init() {
+
+    span_alpha = NULL;
+    span_const = NULL;
+
+    if (get_memory_model() != DIRECT_COLOR_MODE)
+        return BLEND_OK;
+
+    pixel_size = calculate_size_in_bytes(get_bits_per_pixel());
+    field_position[0] = get_red_field_position();
+    field_position[1] = get_green_field_position();
+    field_position[2] = get_blue_field_position();
+    mask_size[0] = get_red_mask_size();
+    mask_size[1] = get_green_mask_size();
+    mask_size[2] = get_blue_mask_size();
+
+    /* Widen every channel value to 8 bits, replicating the top bits */
+    for (uint8_t c = 0; c < 3; c++) {
+        if (mask_size[c] == 0 || mask_size[c] > BYTE_SIZE) {
+            printf("(%s) Unsupported channel size: %d\n", __func__, mask_size[c]);
+            return BLEND_INVALID_COLOR_MODE;
+        }
+        for (uint16_t v = 0; v < (1 << mask_size[c]); v++) {
+            uint32_t value = 0;
+            uint8_t bits = 0;
+            for (; bits < BYTE_SIZE; bits += mask_size[c])
+                value = (value << mask_size[c]) | v;
+            expand_lut[c][v] = value >> (bits - BYTE_SIZE);
+        }
+    }
+
+    bool rgb_8888 = (pixel_size == 4 && field_position[0] == 16 && field_position[1] == 8 && field_position[2] == 0 &&
+                     mask_size[0] == 8 && mask_size[1] == 8 && mask_size[2] == 8);
+    bool rgb_565 = (pixel_size == 2 && field_position[0] == 11 && field_position[1] == 5 && field_position[2] == 0 &&
+                    mask_size[0] == 5 && mask_size[1] == 6 && mask_size[2] == 5);
+
+    if (rgb_8888) {
+        span_alpha = blend_argb32;
+        span_const = blend_const32;
+    }
+    else if (rgb_565) {
+        span_alpha = blend_argb_565;
+        span_const = blend_const_565;
+    }
+    else {
+        span_alpha = blend_argb_generic;
+        span_const = blend_const_generic;
+    }
+
+    return BLEND_OK;
+}
+
+void blend_span(uint8_t *dst, const uint32_t *argb, size_t count) {
+    if (span_alpha != NULL)
+        span_alpha(dst, argb, count);
+}
+
+void blend_span_const(uint8_t *dst, const uint8_t *src, size_t count, uint8_t alpha) {
+    if (span_const == NULL || alpha == ALPHA_TRANSPARENT)
+        return;
+    span_const(dst, src, count, alpha);
+}
+
+bool blend_supported() {
+    return span_alpha != NULL;
+}
@@ -0,0 +1,61 @@
+/*
+ * This file contains the alpha blending kernels used by the blitters
+ */
+#ifndef BLEND_H
+#define BLEND_H
+
+#include <lcom/lcf.h>
+
+/* Alpha of ARGB pixels */
+#define ALPHA_SHIFT 24
+#define ALPHA_OPAQUE 0xFF
+#define ALPHA_TRANSPARENT 0x00
+
+/**
+ * @brief Selects the blending kernels for the current video mode
+ * 
+ * 32 bit ARGB and 16 bit 565 modes get SSE2 kernels, any other direct
+ * color layout a scalar one. Called by vg_init once the mode is known.
+ * 
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int blend_init();
+
+/**
+ * @brief Blends ARGB pixels over pixels in the mode's format, using each pixel's alpha
+ * 
+ * @param dst Pixels to blend onto
+ * @param argb Pixels to blend, alpha in the top 8 bits
+ * @param count Number of pixels
+ */
+void blend_span(uint8_t *dst, const uint32_t *argb, size_t count);
+
+/**
+ * @brief Blends pixels in the mode's format over others with a constant alpha
+ * 
+ * @param dst Pixels to blend onto
+ * @param src Pixels to blend, in the mode's format
+ * @param count Number of pixels
+ * @param alpha Opacity of src, from 0 (invisible) to 255 (opaque)
+ */
+void blend_span_const(uint8_t *dst, const uint8_t *src, size_t count, uint8_t alpha);
+
+/**
+ * @brief Returns true if the current mode can be blended onto
+ * 
+ * @return False for indexed modes or before blend_init
+ */
+bool blend_supported();
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease debugging.
+ */
+typedef enum _blend_status {
+    /* operation was successful */
+    BLEND_OK = OK,
+    /* the mode's channel layout cannot be blended */
+    BLEND_INVALID_COLOR_MODE
+} blend_status;
+
+#endif
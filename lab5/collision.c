@@ -0,0 +1,262 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "collision.h"
+#include "anim.h"
+#include "vbe.h"
+#include "surface.h"
+
+int collision_mask_init(collision_mask *mask, const surface_t *pixels, uint32_t colorkey) {
+
+    if (mask == NULL || pixels == NULL) {
+        printf("(%s) Invalid mask or pixels\n", __func__);
+        return COLLISION_INVALID_ARGS;
+    }
+
+    mask->origin_x = mask->origin_y = 0;
+    mask->width = pixels->width;
+    mask->height = pixels->height;
+    mask->words_per_row = (pixels->width + MASK_WORD_BITS - 1) / MASK_WORD_BITS;
+
+    mask->bits = calloc((size_t) mask->words_per_row * mask->height + 1, sizeof(uint64_t));
+    if (mask->bits == NULL) {
+        printf("(%s) Couldnt allocate a %dx%d mask\n", __func__, mask->width, mask->height);
+        return COLLISION_ALLOC_FAILED;
+    }
+
+    /* Only the bytes of a pixel are compared */
+    uint8_t ps = pixels->pixel_size;
+    if (ps < sizeof(uint32_t))
+        colorkey &= BIT(8 * ps) - 1;
+
+    for (uint16_t y = 0; y < mask->height; y++) {
+        const uint8_t *p = surface_at(pixels, 0, y);
+        uint64_t *row = mask->bits + (size_t) y * mask->words_per_row;
+
+        for (uint16_t x = 0; x < mask->width; x++, p += ps) {
+            uint32_t value = 0;
+            memcpy(&value, p, ps);
+            if (value != colorkey)
+                row[x / MASK_WORD_BITS] |= (uint64_t) 1 << (x % MASK_WORD_BITS);
+        }
+    }
+
+    return COLLISION_OK;
+}
+
+int collision_mask_from_frame(collision_mask *mask, const sprite_sheet *sheet, uint16_t frame) {
+
+    if (sheet == NULL || frame >= sheet->frame_count) {
+        printf("(%s) Invalid sheet or frame\n", __func__);
+        return COLLISION_INVALID_ARGS;
+    }
+
+    /* Build the mask over the opaque bounds only */
+    const sprite_frame *f = &sheet->frames[frame];
+    surface_t opaque;
+    surface_view(&opaque, &sheet->pixels, f->source.x + f->opaque.x, f->source.y + f->opaque.y, f->opaque.width, f->opaque.height);
+
+    int res = collision_mask_init(mask, &opaque, sheet->colorkey);
+    if (res != COLLISION_OK)
+        return res;
+
+    mask->origin_x = f->opaque.x - f->pivot_x;
+    mask->origin_y = f->opaque.y - f->pivot_y;
+    return COLLISION_OK;
+}
+
+void collision_mask_free(collision_mask *mask) {
+    free(mask->bits);
+    mask->bits = NULL;
+}
+
+bool collision_test(const collision_object *a, const collision_object *b) {
+
+    const collision_mask *ma = a->mask, *mb = b->mask;
+    int32_t ax = a->x + ma->origin_x, ay = a->y + ma->origin_y;
+    int32_t bx = b->x + mb->origin_x, by = b->y + mb->origin_y;
+
+    /* Bounding box reject */
+    if (ax >= bx + mb->width || bx >= ax + ma->width || ay >= by + mb->height || by >= ay + ma->height)
+        return false;
+
+    /* Make b the mask further to the right, so it is the one shifted */
+    if (bx < ax) {
+        const collision_mask *m = ma; ma = mb; mb = m;
+        int32_t t = ax; ax = bx; bx = t;
+        t = ay; ay = by; by = t;
+    }
+
+    int32_t dx = bx - ax;
+    uint16_t first_word = dx / MASK_WORD_BITS;
+    uint8_t shift = dx % MASK_WORD_BITS;
+
+    int32_t y0 = (ay > by ? ay : by);
+    int32_t y1 = (ay + ma->height < by + mb->height ? ay + ma->height : by + mb->height);
+
+    for (int32_t y = y0; y < y1; y++) {
+        const uint64_t *row_a = ma->bits + (size_t) (y - ay) * ma->words_per_row;
+        const uint64_t *row_b = mb->bits + (size_t) (y - by) * mb->words_per_row;
+
+        /* Word k of b, shifted into place, lines up with word first_word + k of a */
+        for (uint16_t k = 0; first_word + k < ma->words_per_row && k <= mb->words_per_row; k++) {
+            uint64_t aligned = (k < mb->words_per_row ? row_b[k] << shift : 0);
+            if (shift && k > 0)
+                aligned |= row_b[k - 1] >> (MASK_WORD_BITS - shift);
+            if (row_a[first_word + k] & aligned)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+int collision_grid_init(collision_grid *grid, uint16_t width, uint16_t height, uint16_t cell_size) {
+
+    if (grid == NULL || width == 0 || height == 0 || cell_size == 0) {
+        printf("(%s) Invalid grid dimensions\n", __func__);
+        return COLLISION_INVALID_ARGS;
+    }
+
+    memset(grid, 0, sizeof(collision_grid));
+    grid->cell_size = cell_size;
+    grid->cols = (width + cell_size - 1) / cell_size;
+    grid->rows = (height + cell_size - 1) / cell_size;
+
+    grid->cell_start = malloc(((size_t) grid->cols * grid->rows + 1) * sizeof(uint32_t));
+    grid->refs = malloc(COLLISION_REFS_INITIAL * sizeof(uint32_t));
+    grid->pairs = malloc(COLLISION_PAIRS_INITIAL * sizeof(collision_pair));
+    if (grid->cell_start == NULL || grid->refs == NULL || grid->pairs == NULL) {
+        printf("(%s) Couldnt allocate the grid\n", __func__);
+        collision_grid_free(grid);
+        return COLLISION_ALLOC_FAILED;
+    }
+
+    grid->ref_capacity = COLLISION_REFS_INITIAL;
+    grid->pair_capacity = COLLISION_PAIRS_INITIAL;
+    return COLLISION_OK;
+}
+
+void collision_grid_free(collision_grid *grid) {
+    free(grid->cell_start);
+    free(grid->refs);
+    free(grid->pairs);
+    memset(grid, 0, sizeof(collision_grid));
+}
+
+/*
+ * Returns the cells an object's mask touches, false if it is outside the grid
+ */
+static bool object_cells(const collision_grid *grid, const collision_object *o, int32_t *c0, int32_t *r0, int32_t *c1, int32_t *r1) {
+
+    int32_t x = o->x + o->mask->origin_x, y = o->y + o->mask->origin_y;
+    int32_t x1 = x + o->mask->width, y1 = y + o->mask->height;
+    if (x1 <= 0 || y1 <= 0 || o->mask->width == 0 || o->mask->height == 0)
+        return false;
+
+    *c0 = (x < 0 ? 0 : x / grid->cell_size);
+    *r0 = (y < 0 ? 0 : y / grid->cell_size);
+    *c1 = (x1 - 1) / grid->cell_size;
+    *r1 = (y1 - 1) / grid->cell_size;
+    if (*c0 >= grid->cols || *r0 >= grid->rows)
+        return false;
+
+    if (*c1 >= grid->cols) *c1 = grid->cols - 1;
+    if (*r1 >= grid->rows) *r1 = grid->rows - 1;
+    return true;
+}
+
+/*
+ * Returns the cell holding a point, clamped to the grid
+ */
+static uint32_t point_cell(const collision_grid *grid, int32_t x, int32_t y) {
+    int32_t c = (x < 0 ? 0 : x / grid->cell_size), r = (y < 0 ? 0 : y / grid->cell_size);
+    if (c >= grid->cols) c = grid->cols - 1;
+    if (r >= grid->rows) r = grid->rows - 1;
+    return (uint32_t) r * grid->cols + c;
+}
+
+static int push_pair(collision_grid *grid, uint32_t a, uint32_t b) {
+
+    if (grid->pair_count == grid->pair_capacity) {
+        collision_pair *pairs = realloc(grid->pairs, 2 * grid->pair_capacity * sizeof(collision_pair));
+        if (pairs == NULL) {
+            printf("(%s) Couldnt grow the pairs array\n", __func__);
+            return COLLISION_ALLOC_FAILED;
+        }
+        grid->pairs = pairs;
+        grid->pair_capacity *= 2;
+    }
+
+    grid->pairs[grid->pair_count++] = (collision_pair) {a, b};
+    return COLLISION_OK;
+}
+
+int collision_find_pairs(collision_grid *grid, const collision_object *objects, uint32_t count) {
+
+    uint32_t cells = (uint32_t) grid->cols * grid->rows;
+    int32_t c0, r0, c1, r1;
+
+    /* Count the references of each cell */
+    memset(grid->cell_start, 0, (cells + 1) * sizeof(uint32_t));
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!object_cells(grid, &objects[i], &c0, &r0, &c1, &r1))
+            continue;
+        for (int32_t r = r0; r <= r1; r++)
+            for (int32_t c = c0; c <= c1; c++)
+                grid->cell_start[r * grid->cols + c]++;
+        total += (uint32_t) (r1 - r0 + 1) * (c1 - c0 + 1);
+    }
+
+    if (total > grid->ref_capacity) {
+        uint32_t capacity = grid->ref_capacity;
+        while (capacity < total)
+            capacity *= 2;
+        uint32_t *refs = realloc(grid->refs, capacity * sizeof(uint32_t));
+        if (refs == NULL) {
+            printf("(%s) Couldnt grow the references array\n", __func__);
+            return COLLISION_ALLOC_FAILED;
+        }
+        grid->refs = refs;
+        grid->ref_capacity = capacity;
+    }
+
+    /* Turn the counts into the end of each cell, then fill backwards so each ends up at its start */
+    uint32_t sum = 0;
+    for (uint32_t c = 0; c < cells; c++) {
+        sum += grid->cell_start[c];
+        grid->cell_start[c] = sum;
+    }
+    grid->cell_start[cells] = total;
+
+    for (uint32_t i = count; i-- > 0;) {
+        if (!object_cells(grid, &objects[i], &c0, &r0, &c1, &r1))
+            continue;
+        for (int32_t r = r0; r <= r1; r++)
+            for (int32_t c = c0; c <= c1; c++)
+                grid->refs[--grid->cell_start[r * grid->cols + c]] = i;
+    }
+
+    /* Pair up the objects sharing each cell */
+    grid->pair_count = 0;
+    for (uint32_t cell = 0; cell < cells; cell++) {
+        for (uint32_t p = grid->cell_start[cell]; p < grid->cell_start[cell + 1]; p++) {
+            const collision_object *a = &objects[grid->refs[p]];
+            int32_t ax = a->x + a->mask->origin_x, ay = a->y + a->mask->origin_y;
+
+            for (uint32_t q = p + 1; q < grid->cell_start[cell + 1]; q++) {
+                const collision_object *b = &objects[grid->refs[q]];
+                int32_t bx = b->x + b->mask->origin_x, by = b->y + b->mask->origin_y;
+
+                /* Objects sharing several cells are only tested in the one holding the corner of their overlap */
+                if (point_cell(grid, (ax > bx ? ax : bx), (ay > by ? ay : by)) != cell)
+                    continue;
+
+                if (collision_test(a, b) && push_pair(grid, grid->refs[p], grid->refs[q]) != COLLISION_OK)
+                    return COLLISION_ALLOC_FAILED;
+            }
+        }
+    }
+
+    return COLLISION_OK;
+}
@@ -0,0 +1,136 @@
+/*
+ * This file contains the pixel perfect collision tests.
+ * Masks keep one bit per pixel, packed 64 to a word, so two rows are
+ * compared a word at a time. A uniform grid only pairs up nearby objects.
+ */
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <lcom/lcf.h>
+#include "vbe.h"
+#include "anim.h"
+
+#define MASK_WORD_BITS 64
+
+/* Cell references and pairs preallocated for a grid, grown by doubling when needed */
+#define COLLISION_REFS_INITIAL 1024
+#define COLLISION_PAIRS_INITIAL 256
+
+/* Opaque pixels of an image, one bit each */
+typedef struct {
+    int16_t origin_x, origin_y; /* Top left corner relative to the position of the object */
+    uint16_t width, height;
+    uint16_t words_per_row;
+    uint64_t *bits; /* Bit x % 64 of word x / 64 of a row is pixel x, unused bits are 0 */
+} collision_mask;
+
+/* Object placed for a collision test */
+typedef struct {
+    const collision_mask *mask;
+    int16_t x, y; /* Position, the mask is offset from it by its origin */
+} collision_object;
+
+/* Indices of two colliding objects */
+typedef struct {
+    uint32_t a, b;
+} collision_pair;
+
+/* Uniform grid of square cells listing the objects that touch each of them */
+typedef struct {
+    uint16_t cell_size;
+    uint16_t cols, rows;
+    uint32_t *cell_start; /* Index of the first reference of each cell, cols * rows + 1 entries */
+    uint32_t *refs; /* Objects of each cell, cell after cell */
+    uint32_t ref_capacity;
+    collision_pair *pairs; /* Colliding pairs found by the last collision_find_pairs */
+    uint32_t pair_count, pair_capacity;
+} collision_grid;
+
+/**
+ * @brief Builds the collision mask of an image
+ * 
+ * Works on pixmaps from read_xpm wrapped with surface_wrap
+ * 
+ * @param mask Address of memory to be initialized
+ * @param pixels Image to build the mask from
+ * @param colorkey Color of the transparent pixels, in the image's pixel format
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int collision_mask_init(collision_mask *mask, const surface_t *pixels, uint32_t colorkey);
+
+/**
+ * @brief Builds the collision mask of a frame of a sprite sheet
+ * 
+ * Only the opaque bounds of the frame are kept, placed relative to its pivot
+ * 
+ * @param mask Address of memory to be initialized
+ * @param sheet Sheet holding the frame
+ * @param frame Index of the frame
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int collision_mask_from_frame(collision_mask *mask, const sprite_sheet *sheet, uint16_t frame);
+
+/**
+ * @brief Frees the bits of a collision mask
+ * 
+ * @param mask Mask to free
+ */
+void collision_mask_free(collision_mask *mask);
+
+/**
+ * @brief Tests whether two placed masks have an opaque pixel in common
+ * 
+ * Masks whose bounding boxes do not overlap are rejected before any bit is read
+ * 
+ * @param a First object
+ * @param b Second object
+ * @return True if they collide
+ */
+bool collision_test(const collision_object *a, const collision_object *b);
+
+/**
+ * @brief Initializes a grid covering an area
+ * 
+ * Objects are only paired up in the parts of them inside the area
+ * 
+ * @param grid Address of memory to be initialized
+ * @param width Size in pixels of the area along the x axis
+ * @param height Size in pixels of the area along the y axis
+ * @param cell_size Size in pixels of the side of a cell, about the size of a typical object
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int collision_grid_init(collision_grid *grid, uint16_t width, uint16_t height, uint16_t cell_size);
+
+/**
+ * @brief Frees the buffers of a grid
+ * 
+ * @param grid Grid to free
+ */
+void collision_grid_free(collision_grid *grid);
+
+/**
+ * @brief Finds every pair of colliding objects
+ * 
+ * The pairs are left in grid->pairs, each reported once with a < b
+ * 
+ * @param grid Grid to sort the objects into
+ * @param objects Objects to test
+ * @param count Number of objects
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int collision_find_pairs(collision_grid *grid, const collision_object *objects, uint32_t count);
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease debugging.
+ */
+typedef enum _collision_status {
+    /* operation was successful */
+    COLLISION_OK = OK,
+    /* invalid arguments */
+    COLLISION_INVALID_ARGS,
+    /* failed allocating memory */
+    COLLISION_ALLOC_FAILED
+} collision_status;
+
+#endif /* end of include guard: COLLISION_H */
@@ -0,0 +1,372 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "fill.h"
+#include "vbe.h"
+#include "fixed.h"
+#include "palette.h"
+#include "util.h"
+
+/* Run of pixels [x_left, x_right] on row y, whose neighbours on row y + dy are still to be scanned */
+typedef struct {
+    int16_t y, x_left, x_right, dy;
+} fill_segment;
+
+/* Allocated by fill_init and kept between fills, so most fills never allocate */
+static fill_segment *fill_stack = NULL;
+static size_t fill_stack_capacity = 0;
+
+/* Layout of the surface being filled */
+typedef struct {
+    surface_t *surface;
+    uint16_t x_res, y_res;
+    uint8_t pixel_size;
+    uint32_t color, old_color;
+    size_t top;
+} fill_state;
+
+static inline uint32_t read_pixel(const uint8_t *p, uint8_t pixel_size) {
+    switch (pixel_size) {
+        case 1: return *p;
+        case 2: return *(const uint16_t *) p;
+        case 3: return p[0] | (p[1] << 8) | ((uint32_t) p[2] << 16);
+        default: return *(const uint32_t *) p;
+    }
+}
+
+static inline bool matches(const fill_state *s, int32_t x, int32_t y) {
+    return read_pixel(surface_at(s->surface, x, y), s->pixel_size) == s->old_color;
+}
+
+/*
+ * Pushes a segment if the row it leads to is inside the surface
+ */
+static bool push_segment(fill_state *s, int32_t y, int32_t x_left, int32_t x_right, int32_t dy) {
+    if (y + dy < 0 || y + dy >= s->y_res)
+        return true;
+
+    if (s->top == fill_stack_capacity) {
+        size_t capacity = 2 * fill_stack_capacity;
+        fill_segment *stack = realloc(fill_stack, capacity * sizeof(fill_segment));
+        if (stack == NULL)
+            return false;
+        fill_stack = stack;
+        fill_stack_capacity = capacity;
+    }
+
+    fill_segment *segment = &fill_stack[s->top++];
+    segment->y = y;
+    segment->x_left = x_left;
+    segment->x_right = x_right;
+    segment->dy = dy;
+    return true;
+}
+
+int fill_init() {
+
+    /* Reallocated on every mode change, like the shadow frame */
+    free(fill_stack);
+    fill_stack_capacity = 0;
+    fill_stack = malloc(FILL_STACK_INITIAL * sizeof(fill_segment));
+    if (fill_stack == NULL) {
+        printf("(%s) Couldnt allocate the fill stack\n", __func__);
+        return FILL_ALLOC_FAILED;
+    }
+
+    fill_stack_capacity = FILL_STACK_INITIAL;
+    return FILL_OK;
+}
+
+int flood_fill_on(uint16_t x, uint16_t y, uint32_t color, surface_t *surface) {
+
+    if (surface == NULL) {
+        printf("(%s) Invalid surface\n", __func__);
+        return FILL_INVALID_ARGS;
+    }
+
+    fill_state s;
+    s.surface = surface;
+    s.top = 0;
+    s.x_res = surface->width;
+    s.y_res = surface->height;
+    s.pixel_size = surface->pixel_size;
+
+    if (x >= s.x_res || y >= s.y_res) {
+        printf("(%s) Seed is outside the surface\n", __func__);
+        return FILL_INVALID_ARGS;
+    }
+
+    /* Without the preallocated stack nothing is drawn */
+    if (fill_stack == NULL) {
+        printf("(%s) The fill stack was not allocated\n", __func__);
+        return FILL_ALLOC_FAILED;
+    }
+
+    s.color = (s.pixel_size == 4 ? color : color & (BIT(8 * s.pixel_size) - 1));
+    s.old_color = read_pixel(surface_at(surface, x, y), s.pixel_size);
+    if (s.color == s.old_color)
+        return FILL_OK;
+
+    /* The seed row is scanned first, spreading both ways from there */
+    bool ok = push_segment(&s, y, x, x, 1) && push_segment(&s, y + 1, x, x, -1);
+
+    while (ok && s.top > 0) {
+        fill_segment segment = fill_stack[--s.top];
+        int32_t row = segment.y + segment.dy, dy = segment.dy;
+        int32_t x1 = segment.x_left, x2 = segment.x_right;
+        int32_t left, right;
+
+        /* A run touching x1 may extend to the left past the parent segment */
+        if (matches(&s, x1, row)) {
+            left = x1;
+            while (left > 0 && matches(&s, left - 1, row))
+                left--;
+            if (left < x1)
+                ok = push_segment(&s, row, left, x1 - 1, -dy);
+            right = x1;
+        }
+        else {
+            right = x1 + 1;
+            while (right <= x2 && !matches(&s, right, row))
+                right++;
+            if (right > x2)
+                continue;
+            left = right;
+        }
+
+        /* Every run overlapping [x1, x2] is filled and its neighbours scanned */
+        while (ok) {
+            while (right + 1 < s.x_res && matches(&s, right + 1, row))
+                right++;
+            fill_pixels(surface_at(surface, left, row), s.color, right - left + 1, s.pixel_size);
+
+            ok = push_segment(&s, row, left, right, dy);
+            /* Past the parent's end, the run may leak back around a corner */
+            if (ok && right > x2)
+                ok = push_segment(&s, row, x2 + 1, right, -dy);
+
+            /* right + 1 is a boundary, look for the next run */
+            right += 2;
+            while (right <= x2 && !matches(&s, right, row))
+                right++;
+            if (right > x2)
+                break;
+            left = right;
+        }
+    }
+
+    vg_target_modified(surface->pixels);
+
+    if (!ok) {
+        printf("(%s) Couldnt grow the fill stack\n", __func__);
+        return FILL_ALLOC_FAILED;
+    }
+    return FILL_OK;
+}
+
+/* Where each component goes in a direct color pixel */
+typedef struct {
+    uint8_t position[3];
+    uint8_t dropped_bits[3]; /* Low bits of the 8 bit component that do not fit */
+} channel_layout;
+
+/* Colors along a gradient, ready to write */
+typedef struct {
+    uint8_t rgb[GRADIENT_RAMP_SIZE][3];
+    uint32_t packed[GRADIENT_RAMP_SIZE];
+    channel_layout layout;
+    bool indexed, dither;
+} gradient_ramp;
+
+static gradient_ramp ramp;
+
+/* sqrt_lut[i] = sqrt(4 * i), so the result spans the whole ramp */
+static uint8_t sqrt_lut[GRADIENT_SQRT_SIZE];
+static bool sqrt_lut_initialized = false;
+
+/* 4x4 Bayer matrix, as thresholds 2 * b + 1 out of 32 */
+static const uint8_t gradient_bayer[4][4] = {
+    {1, 17, 5, 21}, {25, 9, 29, 13}, {7, 23, 3, 19}, {31, 15, 27, 11}
+};
+
+static inline void write_pixel(uint8_t *p, uint32_t color, uint8_t pixel_size) {
+    switch (pixel_size) {
+        case 1: *p = color; break;
+        case 2: *(uint16_t *) p = color; break;
+        case 3: p[0] = color; p[1] = color >> 8; p[2] = color >> 16; break;
+        default: *(uint32_t *) p = color; break;
+    }
+}
+
+static void init_sqrt_lut() {
+    uint32_t root = 0;
+    for (uint32_t i = 0; i < GRADIENT_SQRT_SIZE; i++) {
+        while ((root + 1) * (root + 1) <= 4 * i)
+            root++;
+        sqrt_lut[i] = root;
+    }
+    sqrt_lut_initialized = true;
+}
+
+static inline uint32_t pack_layout(const channel_layout *layout, const uint8_t rgb[3]) {
+    return ((uint32_t) (rgb[0] >> layout->dropped_bits[0]) << layout->position[0]) |
+           ((uint32_t) (rgb[1] >> layout->dropped_bits[1]) << layout->position[1]) |
+           ((uint32_t) (rgb[2] >> layout->dropped_bits[2]) << layout->position[2]);
+}
+
+/*
+ * Steps each component from the first color to the second in 16.16 fixed point
+ */
+static void build_ramp(uint32_t rgb0, uint32_t rgb1, uint8_t pixel_size, bool dither) {
+
+    /* Direct color buffers always take at least 2 bytes per pixel */
+    ramp.indexed = (pixel_size == 1);
+
+    channel_layout *layout = &ramp.layout;
+    layout->position[0] = get_red_field_position();
+    layout->position[1] = get_green_field_position();
+    layout->position[2] = get_blue_field_position();
+    layout->dropped_bits[0] = BYTE_SIZE - get_red_mask_size();
+    layout->dropped_bits[1] = BYTE_SIZE - get_green_mask_size();
+    layout->dropped_bits[2] = BYTE_SIZE - get_blue_mask_size();
+
+    /* Ordered dithering only pays off when components lose bits */
+    ramp.dither = dither && (ramp.indexed || layout->dropped_bits[0] || layout->dropped_bits[1] || layout->dropped_bits[2]);
+
+    for (uint8_t c = 0; c < 3; c++) {
+        uint8_t shift = 16 - 8 * c;
+        fixed_t value = INT_TO_FIXED((rgb0 >> shift) & 0xFF) + FIXED_HALF;
+        fixed_t step = (INT_TO_FIXED((rgb1 >> shift) & 0xFF) - INT_TO_FIXED((rgb0 >> shift) & 0xFF)) / (GRADIENT_RAMP_SIZE - 1);
+
+        for (uint32_t i = 0; i < GRADIENT_RAMP_SIZE; i++, value += step)
+            ramp.rgb[i][c] = FIXED_TO_INT(value);
+    }
+
+    for (uint32_t i = 0; i < GRADIENT_RAMP_SIZE; i++)
+        ramp.packed[i] = (ramp.indexed ? palette_nearest(ramp.rgb[i][0], ramp.rgb[i][1], ramp.rgb[i][2]) : pack_layout(layout, ramp.rgb[i]));
+}
+
+/*
+ * Color of ramp entry i at pixel (x, y)
+ */
+static inline uint32_t ramp_color(uint8_t i, uint16_t x, uint16_t y) {
+    if (!ramp.dither)
+        return ramp.packed[i];
+
+    if (ramp.indexed)
+        return palette_nearest_dithered(ramp.rgb[i][0], ramp.rgb[i][1], ramp.rgb[i][2], x, y);
+
+    /* Adding a threshold below one quantization step before truncating dithers between the two nearest levels */
+    uint8_t threshold = gradient_bayer[y & 3][x & 3], dithered[3];
+    for (uint8_t c = 0; c < 3; c++) {
+        uint32_t value = ramp.rgb[i][c] + ((threshold << ramp.layout.dropped_bits[c]) >> 5);
+        dithered[c] = (value > 0xFF ? 0xFF : value);
+    }
+    return pack_layout(&ramp.layout, dithered);
+}
+
+/*
+ * Clips a rectangle to the surface, returns false if nothing is left
+ */
+static bool clip_rectangle(int32_t *x0, int32_t *y0, int32_t *x1, int32_t *y1, uint16_t x_res, uint16_t y_res) {
+    if (*x0 < 0) *x0 = 0;
+    if (*y0 < 0) *y0 = 0;
+    if (*x1 > x_res) *x1 = x_res;
+    if (*y1 > y_res) *y1 = y_res;
+    return *x0 < *x1 && *y0 < *y1;
+}
+
+int fill_linear_gradient_on(int16_t x, int16_t y, uint16_t width, uint16_t height, const gradient_stop *from, const gradient_stop *to, bool dither, surface_t *surface) {
+
+    if (surface == NULL || from == NULL || to == NULL) {
+        printf("(%s) Invalid arguments\n", __func__);
+        return FILL_INVALID_ARGS;
+    }
+
+    uint16_t x_res = surface->width, y_res = surface->height;
+    uint8_t pixel_size = surface->pixel_size;
+
+    int32_t x0 = x, y0 = y, x1 = x + width, y1 = y + height;
+    if (!clip_rectangle(&x0, &y0, &x1, &y1, x_res, y_res))
+        return FILL_OK;
+
+    build_ramp(from->rgb, to->rgb, pixel_size, dither);
+
+    /*
+     * Position along the gradient, 0 at the first stop and 1 at the second, in 32.32 fixed point.
+     * It is the projection on the stops' direction, so it changes by a constant amount per pixel and per row.
+     */
+    int64_t dx = to->x - from->x, dy = to->y - from->y;
+    int64_t length_squared = dx * dx + dy * dy;
+    int64_t step_x = 0, step_y = 0;
+    if (length_squared != 0) {
+        step_x = dx * ((int64_t) 1 << 32) / length_squared;
+        step_y = dy * ((int64_t) 1 << 32) / length_squared;
+    }
+    int64_t row_position = (x0 - from->x) * step_x + (y0 - from->y) * step_y;
+
+    for (int32_t row = y0; row < y1; row++, row_position += step_y) {
+        uint8_t *p = surface_at(surface, x0, row);
+        int64_t position = row_position;
+
+        for (int32_t col = x0; col < x1; col++, position += step_x, p += pixel_size) {
+            uint8_t i;
+            if (position <= 0)
+                i = 0;
+            else if (position >= ((int64_t) 1 << 32))
+                i = GRADIENT_RAMP_SIZE - 1;
+            else
+                i = position >> (32 - GRADIENT_RAMP_BITS);
+            write_pixel(p, ramp_color(i, col, row), pixel_size);
+        }
+    }
+
+    vg_target_modified(surface->pixels);
+    return FILL_OK;
+}
+
+int fill_radial_gradient_on(int16_t x, int16_t y, uint16_t width, uint16_t height, const gradient_stop *center, uint16_t radius, uint32_t outer_rgb, bool dither, surface_t *surface) {
+
+    if (surface == NULL || center == NULL || radius == 0) {
+        printf("(%s) Invalid arguments\n", __func__);
+        return FILL_INVALID_ARGS;
+    }
+
+    uint16_t x_res = surface->width, y_res = surface->height;
+    uint8_t pixel_size = surface->pixel_size;
+
+    int32_t x0 = x, y0 = y, x1 = x + width, y1 = y + height;
+    if (!clip_rectangle(&x0, &y0, &x1, &y1, x_res, y_res))
+        return FILL_OK;
+
+    build_ramp(center->rgb, outer_rgb, pixel_size, dither);
+    if (!sqrt_lut_initialized)
+        init_sqrt_lut();
+
+    /*
+     * The squared distance changes by 2 * dx + 1 from one pixel to the next.
+     * Scaled so the radius maps to 2^48, its top bits index the square root table.
+     */
+    uint64_t radius_squared = (uint64_t) radius * radius;
+    uint64_t scale = ((uint64_t) 1 << 48) / radius_squared;
+
+    for (int32_t row = y0; row < y1; row++) {
+        uint8_t *p = surface_at(surface, x0, row);
+        int64_t dx = x0 - center->x, dy = row - center->y;
+        uint64_t distance_squared = dx * dx + dy * dy;
+
+        for (int32_t col = x0; col < x1; col++, p += pixel_size) {
+            uint8_t i;
+            if (distance_squared >= radius_squared)
+                i = GRADIENT_RAMP_SIZE - 1;
+            else
+                i = sqrt_lut[(distance_squared * scale) >> (48 - GRADIENT_SQRT_BITS)];
+            write_pixel(p, ramp_color(i, col, row), pixel_size);
+
+            distance_squared += 2 * dx + 1;
+            dx++;
+        }
+    }
+
+    vg_target_modified(surface->pixels);
+    return FILL_OK;
+}
@@ -0,0 +1,97 @@
+/*
+ * This file contains the region fills: flood fill and gradients
+ */
+#ifndef FILL_H
+#define FILL_H
+
+#include <lcom/lcf.h>
+#include "vbe.h"
+
+/* Segments of the flood fill stack allocated by fill_init, grown by doubling when a fill needs more */
+#define FILL_STACK_INITIAL 1024
+
+/* Colors precomputed along a gradient, indexed by position */
+#define GRADIENT_RAMP_BITS 8
+#define GRADIENT_RAMP_SIZE BIT(GRADIENT_RAMP_BITS)
+/* Radial gradients take the square root of the squared distance through a table of this many entries */
+#define GRADIENT_SQRT_BITS 14
+#define GRADIENT_SQRT_SIZE BIT(GRADIENT_SQRT_BITS)
+
+/* Point where a gradient has the given color */
+typedef struct {
+    int16_t x, y;
+    uint32_t rgb; /* 0x00RRGGBB */
+} gradient_stop;
+
+/**
+ * @brief Allocates the flood fill stack
+ * 
+ * Called by vg_init, so fills do not allocate unless a region needs more than FILL_STACK_INITIAL segments
+ * 
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int fill_init();
+
+/**
+ * @brief Replaces the 4-connected region of pixels with the same value as (x, y) by a color
+ * 
+ * Works on any surface format, comparing raw pixel values
+ * 
+ * @param x Seed coordinate along the x axis
+ * @param y Seed coordinate along the y axis
+ * @param color Color in the surface's pixel format
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int flood_fill_on(uint16_t x, uint16_t y, uint32_t color, surface_t *surface);
+
+/**
+ * @brief Fills a rectangle with a linear gradient
+ * 
+ * Colors change along the line between the two stops and are constant across it,
+ * pixels beyond either stop take its color
+ * 
+ * @param x Top left corner coordinate along the x axis, may be off the surface
+ * @param y Top left corner coordinate along the y axis, may be off the surface
+ * @param width Size in pixels of the rectangle along the x axis
+ * @param height Size in pixels of the rectangle along the y axis
+ * @param from Stop where the gradient starts
+ * @param to Stop where the gradient ends
+ * @param dither True to apply ordered dithering in 8 and 16 bit formats
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int fill_linear_gradient_on(int16_t x, int16_t y, uint16_t width, uint16_t height, const gradient_stop *from, const gradient_stop *to, bool dither, surface_t *surface);
+
+/**
+ * @brief Fills a rectangle with a radial gradient
+ * 
+ * Pixels beyond the radius take the outer color
+ * 
+ * @param x Top left corner coordinate along the x axis, may be off the surface
+ * @param y Top left corner coordinate along the y axis, may be off the surface
+ * @param width Size in pixels of the rectangle along the x axis
+ * @param height Size in pixels of the rectangle along the y axis
+ * @param center Center of the gradient and its color
+ * @param radius Distance in pixels at which the outer color is reached
+ * @param outer_rgb Outer color as 0x00RRGGBB
+ * @param dither True to apply ordered dithering in 8 and 16 bit formats
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int fill_radial_gradient_on(int16_t x, int16_t y, uint16_t width, uint16_t height, const gradient_stop *center, uint16_t radius, uint32_t outer_rgb, bool dither, surface_t *surface);
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease debugging.
+ */
+typedef enum _fill_status {
+    /* operation was successful */
+    FILL_OK = OK,
+    /* invalid arguments */
+    FILL_INVALID_ARGS,
+    /* failed allocating memory */
+    FILL_ALLOC_FAILED
+} fill_status;
+
+#endif /* end of include guard: FILL_H */
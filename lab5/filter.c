@@ -0,0 +1,248 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "filter.h"
+#include "vbe.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Copy of the region for the vertical pass, kept between calls */
+static uint8_t *scratch = NULL;
+static size_t scratch_size = 0;
+
+/* Region being blurred, channels interleaved */
+typedef struct {
+    uint8_t *base;
+    size_t pitch;
+    uint16_t width, height;
+    uint8_t channels;
+    uint16_t radius;
+    uint16_t reciprocal; /* 65536 / (2 * radius + 1), rounded up so full windows stay at 255 */
+} blur_region;
+
+static bool reserve_scratch(size_t size) {
+    if (size <= scratch_size)
+        return true;
+
+    uint8_t *memory = realloc(scratch, size);
+    if (memory == NULL)
+        return false;
+    scratch = memory;
+    scratch_size = size;
+    return true;
+}
+
+/*
+ * Average of a window from its sum, rounding to the nearest value
+ */
+static inline uint8_t window_average(uint32_t sum, const blur_region *r) {
+    /* Saturates like the SSE2 path */
+    uint32_t rounded = sum + r->radius;
+    uint32_t value = ((rounded > 0xFFFF ? 0xFFFF : rounded) * r->reciprocal) >> 16;
+    return (value > 0xFF ? 0xFF : value);
+}
+
+/*
+ * Horizontal pass, in place. Each row is copied first so the values leaving the window are still intact.
+ */
+static void blur_rows(const blur_region *r, uint8_t *row_copy) {
+    int32_t last = r->width - 1, radius = r->radius;
+    uint8_t channels = r->channels;
+
+    for (uint16_t y = 0; y < r->height; y++) {
+        uint8_t *row = r->base + y * r->pitch;
+        memcpy(row_copy, row, (size_t) r->width * channels);
+
+#ifdef __SSE2__
+        /* The 4 channels of a pixel are summed together in 16 bit lanes */
+        if (channels == 4) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i half = _mm_set1_epi16(r->radius);
+            const __m128i reciprocal = _mm_set1_epi16(r->reciprocal);
+            const uint32_t *src = (const uint32_t *) row_copy;
+            uint32_t *dst = (uint32_t *) row;
+
+            #define LOAD_PIXEL(i) _mm_unpacklo_epi8(_mm_cvtsi32_si128(src[i]), zero)
+
+            __m128i sum = _mm_setzero_si128();
+            for (int32_t i = -radius; i <= radius; i++)
+                sum = _mm_add_epi16(sum, LOAD_PIXEL(i < 0 ? 0 : (i > last ? last : i)));
+
+            for (int32_t x = 0; x <= last; x++) {
+                __m128i average = _mm_mulhi_epu16(_mm_adds_epu16(sum, half), reciprocal);
+                dst[x] = _mm_cvtsi128_si32(_mm_packus_epi16(average, zero));
+
+                int32_t in = x + radius + 1, out = x - radius;
+                sum = _mm_add_epi16(sum, LOAD_PIXEL(in > last ? last : in));
+                sum = _mm_sub_epi16(sum, LOAD_PIXEL(out < 0 ? 0 : out));
+            }
+
+            #undef LOAD_PIXEL
+            continue;
+        }
+#endif
+
+        for (uint8_t c = 0; c < channels; c++) {
+            const uint8_t *src = row_copy + c;
+            uint8_t *dst = row + c;
+
+            uint32_t sum = 0;
+            for (int32_t i = -radius; i <= radius; i++)
+                sum += src[(i < 0 ? 0 : (i > last ? last : i)) * channels];
+
+            for (int32_t x = 0; x <= last; x++) {
+                dst[x * channels] = window_average(sum, r);
+
+                int32_t in = x + radius + 1, out = x - radius;
+                sum += src[(in > last ? last : in) * channels];
+                sum -= src[(out < 0 ? 0 : out) * channels];
+            }
+        }
+    }
+}
+
+/*
+ * Vertical pass, from a copy of the region. A running sum per column is updated a whole row at a time.
+ */
+static void blur_columns(const blur_region *r, const uint8_t *copy, uint16_t *sums) {
+    size_t row_size = (size_t) r->width * r->channels;
+    int32_t last = r->height - 1, radius = r->radius;
+
+    #define COPY_ROW(i) (copy + (size_t) ((i) < 0 ? 0 : ((i) > last ? last : (i))) * row_size)
+
+    memset(sums, 0, row_size * sizeof(uint16_t));
+    for (int32_t i = -radius; i <= radius; i++) {
+        const uint8_t *src = COPY_ROW(i);
+        for (size_t j = 0; j < row_size; j++)
+            sums[j] += src[j];
+    }
+
+    for (int32_t y = 0; y <= last; y++) {
+        uint8_t *dst = r->base + y * r->pitch;
+        const uint8_t *in = COPY_ROW(y + radius + 1), *out = COPY_ROW(y - radius);
+        size_t j = 0;
+
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i half = _mm_set1_epi16(r->radius);
+        const __m128i reciprocal = _mm_set1_epi16(r->reciprocal);
+
+        for (; j + 8 <= row_size; j += 8) {
+            __m128i sum = _mm_loadu_si128((const __m128i *) (sums + j));
+            __m128i average = _mm_mulhi_epu16(_mm_adds_epu16(sum, half), reciprocal);
+            _mm_storel_epi64((__m128i *) (dst + j), _mm_packus_epi16(average, zero));
+
+            sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (in + j)), zero));
+            sum = _mm_sub_epi16(sum, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (out + j)), zero));
+            _mm_storeu_si128((__m128i *) (sums + j), sum);
+        }
+#endif
+
+        for (; j < row_size; j++) {
+            dst[j] = window_average(sums[j], r);
+            sums[j] += in[j] - out[j];
+        }
+    }
+
+    #undef COPY_ROW
+}
+
+static int blur_region_passes(blur_region *r, uint8_t passes) {
+
+    if (r->radius == 0 || r->width == 0 || r->height == 0)
+        return FILTER_OK;
+
+    if (r->radius > BLUR_MAX_RADIUS) {
+        printf("(%s) Radius can be at most %d\n", __func__, BLUR_MAX_RADIUS);
+        return FILTER_INVALID_ARGS;
+    }
+
+    r->reciprocal = (65536 + 2 * r->radius) / (2 * r->radius + 1);
+
+    /* Region copy, then column sums, then a row copy */
+    size_t row_size = (size_t) r->width * r->channels;
+    size_t copy_size = row_size * r->height;
+    if (!reserve_scratch(copy_size + row_size * sizeof(uint16_t) + row_size)) {
+        printf("(%s) Couldnt allocate the scratch buffer\n", __func__);
+        return FILTER_ALLOC_FAILED;
+    }
+    uint16_t *sums = (uint16_t *) (scratch + copy_size);
+    uint8_t *row_copy = scratch + copy_size + row_size * sizeof(uint16_t);
+
+    for (uint8_t pass = 0; pass < passes; pass++) {
+        blur_rows(r, row_copy);
+
+        for (uint16_t y = 0; y < r->height; y++)
+            memcpy(scratch + y * row_size, r->base + y * r->pitch, row_size);
+        blur_columns(r, scratch, sums);
+    }
+    return FILTER_OK;
+}
+
+int blur_box_on(int16_t x, int16_t y, uint16_t width, uint16_t height, uint8_t radius, uint8_t passes, surface_t *surface) {
+
+    if (surface == NULL) {
+        printf("(%s) Invalid surface\n", __func__);
+        return FILTER_INVALID_ARGS;
+    }
+
+    uint16_t x_res = surface->width, y_res = surface->height;
+    uint8_t pixel_size = surface->pixel_size;
+
+    if (pixel_size != 4) {
+        printf("(%s) Only 32 bits per pixel surfaces can be blurred\n", __func__);
+        return FILTER_INVALID_COLOR_MODE;
+    }
+
+    /* Clip the region to the surface */
+    int32_t x0 = (x < 0 ? 0 : x), y0 = (y < 0 ? 0 : y);
+    int32_t x1 = x + width, y1 = y + height;
+    if (x1 > x_res) x1 = x_res;
+    if (y1 > y_res) y1 = y_res;
+    if (x0 >= x1 || y0 >= y1)
+        return FILTER_OK;
+
+    blur_region r;
+    r.pitch = surface->pitch;
+    r.base = surface_at(surface, x0, y0);
+    r.width = x1 - x0;
+    r.height = y1 - y0;
+    r.channels = pixel_size;
+    r.radius = radius;
+
+    int status = blur_region_passes(&r, passes);
+    vg_target_modified(surface->pixels);
+    return status;
+}
+
+int blur_gaussian_on(int16_t x, int16_t y, uint16_t width, uint16_t height, uint8_t sigma, surface_t *surface) {
+
+    /*
+     * Box blurs of radius r have variance r * (r + 1) / 3, so GAUSSIAN_PASSES of them
+     * have variance r * (r + 1). Take the largest radius that does not exceed sigma^2.
+     */
+    uint8_t radius = 1;
+    while (radius < BLUR_MAX_RADIUS && (uint32_t) (radius + 1) * (radius + 2) <= (uint32_t) sigma * sigma)
+        radius++;
+
+    return blur_box_on(x, y, width, height, (sigma ? radius : 0), GAUSSIAN_PASSES, surface);
+}
+
+int blur_plane(uint8_t *plane, size_t pitch, uint16_t width, uint16_t height, uint8_t radius, uint8_t passes) {
+
+    if (plane == NULL || pitch < width) {
+        printf("(%s) Invalid plane\n", __func__);
+        return FILTER_INVALID_ARGS;
+    }
+
+    blur_region r;
+    r.base = plane;
+    r.pitch = pitch;
+    r.width = width;
+    r.height = height;
+    r.channels = 1;
+    r.radius = radius;
+
+    return blur_region_passes(&r, passes);
+}
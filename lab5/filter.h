@@ -0,0 +1,74 @@
+/*
+ * This file contains the blur filters, applied in place to regions of a surface
+ */
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <lcom/lcf.h>
+#include "vbe.h"
+
+/* Running sums are kept in 16 bits, so 255 * (2 * radius + 1) must fit */
+#define BLUR_MAX_RADIUS 128
+/* Box passes that approximate a gaussian */
+#define GAUSSIAN_PASSES 3
+
+/**
+ * @brief Applies a box blur to a rectangle of a 32 bits per pixel surface
+ * 
+ * Pixels outside the rectangle are not read, its edges are extended instead
+ * 
+ * @param x Top left corner coordinate along the x axis, may be off the surface
+ * @param y Top left corner coordinate along the y axis, may be off the surface
+ * @param width Size in pixels of the rectangle along the x axis
+ * @param height Size in pixels of the rectangle along the y axis
+ * @param radius Pixels averaged on each side, up to BLUR_MAX_RADIUS
+ * @param passes Number of times the blur is applied
+ * @param surface Surface to blur
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int blur_box_on(int16_t x, int16_t y, uint16_t width, uint16_t height, uint8_t radius, uint8_t passes, surface_t *surface);
+
+/**
+ * @brief Approximates a gaussian blur of a rectangle of a 32 bits per pixel surface with box blurs
+ * 
+ * @param x Top left corner coordinate along the x axis, may be off the surface
+ * @param y Top left corner coordinate along the y axis, may be off the surface
+ * @param width Size in pixels of the rectangle along the x axis
+ * @param height Size in pixels of the rectangle along the y axis
+ * @param sigma Standard deviation in pixels
+ * @param surface Surface to blur
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int blur_gaussian_on(int16_t x, int16_t y, uint16_t width, uint16_t height, uint8_t sigma, surface_t *surface);
+
+/**
+ * @brief Applies a box blur to a plane of 8 bit values, such as a shadow mask
+ * 
+ * Indexed buffers hold palette indices, which can not be averaged, so they are only blurred this way
+ * 
+ * @param plane First value of the region to blur
+ * @param pitch Bytes from one row of the plane to the next
+ * @param width Size in values of the region along the x axis
+ * @param height Size in values of the region along the y axis
+ * @param radius Values averaged on each side, up to BLUR_MAX_RADIUS
+ * @param passes Number of times the blur is applied
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int blur_plane(uint8_t *plane, size_t pitch, uint16_t width, uint16_t height, uint8_t radius, uint8_t passes);
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease debugging.
+ */
+typedef enum _filter_status {
+    /* operation was successful */
+    FILTER_OK = OK,
+    /* invalid arguments */
+    FILTER_INVALID_ARGS,
+    /* the target's pixel format can not be blurred */
+    FILTER_INVALID_COLOR_MODE,
+    /* failed allocating memory */
+    FILTER_ALLOC_FAILED
+} filter_status;
+
+#endif /* end of include guard: FILTER_H */
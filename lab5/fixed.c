@@ -0,0 +1,36 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "fixed.h"
+
+/* Sine of the first quarter turn, 16.16 fixed point, ANGLE_QUARTER + 1 entries */
+static const fixed_t sine_table[ANGLE_QUARTER + 1] = {
+    0, 1608, 3216, 4821, 6424, 8022, 9616, 11204, 12785, 14359, 15924, 17479, 19024, 20557, 22078, 23586,
+    25080, 26558, 28020, 29466, 30893, 32303, 33692, 35062, 36410, 37736, 39040, 40320, 41576, 42806, 44011, 45190,
+    46341, 47464, 48559, 49624, 50660, 51665, 52639, 53581, 54491, 55368, 56212, 57022, 57798, 58538, 59244, 59914,
+    60547, 61145, 61705, 62228, 62714, 63162, 63572, 63944, 64277, 64571, 64827, 65043, 65220, 65358, 65457, 65516,
+    65536
+};
+
+fixed_t fixed_sin(uint8_t angle) {
+    uint8_t index = angle % ANGLE_QUARTER;
+
+    /* The other quarters mirror and/or negate the first one */
+    switch (angle / ANGLE_QUARTER) {
+        case 0: return sine_table[index];
+        case 1: return sine_table[ANGLE_QUARTER - index];
+        case 2: return -sine_table[index];
+        default: return -sine_table[ANGLE_QUARTER - index];
+    }
+}
+
+fixed_t fixed_cos(uint8_t angle) {
+    return fixed_sin((uint8_t) (angle + ANGLE_QUARTER));
+}
+
+int64_t floor_div(int64_t n, int64_t d) {
+    int64_t q = n / d;
+    /* C division truncates, correct it when the result is negative and inexact */
+    if (n % d != 0 && ((n < 0) != (d < 0)))
+        q--;
+    return q;
+}
@@ -0,0 +1,53 @@
+/*
+ * This file contains the 16.16 fixed point helpers used by the blitters and animations
+ */
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <lcom/lcf.h>
+
+/* 16 integer bits, 16 fractional bits */
+typedef int32_t fixed_t;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define FIXED_HALF (FIXED_ONE >> 1)
+
+#define INT_TO_FIXED(n) ((fixed_t) (n) * FIXED_ONE)
+#define FIXED_TO_INT(f) ((f) >> FIXED_SHIFT) /* Rounds towards minus infinity */
+#define FIXED_ROUND(f) (((f) + FIXED_HALF) >> FIXED_SHIFT)
+#define FIXED_FRAC(f) ((f) & (FIXED_ONE - 1))
+
+#define FIXED_MUL(a, b) ((fixed_t) (((int64_t) (a) * (b)) >> FIXED_SHIFT))
+#define FIXED_DIV(a, b) ((fixed_t) (((int64_t) (a) * FIXED_ONE) / (b)))
+
+/* Angles are measured in 256 steps per full turn */
+#define ANGLE_STEPS 256
+#define ANGLE_QUARTER (ANGLE_STEPS / 4)
+
+/**
+ * @brief Returns the sine of an angle, from a table
+ * 
+ * @param angle Angle in 1/256 of a turn
+ * @return Sine in 16.16 fixed point
+ */
+fixed_t fixed_sin(uint8_t angle);
+
+/**
+ * @brief Returns the cosine of an angle, from a table
+ * 
+ * @param angle Angle in 1/256 of a turn
+ * @return Cosine in 16.16 fixed point
+ */
+fixed_t fixed_cos(uint8_t angle);
+
+/**
+ * @brief Divides rounding towards minus infinity, whatever the signs
+ * 
+ * @param n Dividend
+ * @param d Divisor, non-zero
+ * @return Floor of n / d
+ */
+int64_t floor_div(int64_t n, int64_t d);
+
+#endif
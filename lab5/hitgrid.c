@@ -0,0 +1,251 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "hitgrid.h"
+#include "anim.h"
+
+int hit_grid_init(hit_grid *grid, uint16_t width, uint16_t height, uint16_t cell_size) {
+
+    if (grid == NULL || width == 0 || height == 0 || cell_size == 0) {
+        printf("(%s) Invalid grid dimensions\n", __func__);
+        return HIT_INVALID_ARGS;
+    }
+
+    memset(grid, 0, sizeof(hit_grid));
+    grid->cell_size = cell_size;
+    grid->cols = (width + cell_size - 1) / cell_size;
+    grid->rows = (height + cell_size - 1) / cell_size;
+    grid->width = width;
+    grid->height = height;
+
+    /* Cells get their buffers once something is listed in them */
+    grid->cells = calloc((size_t) grid->cols * grid->rows, sizeof(hit_cell));
+    grid->objects = malloc(HIT_GRID_INITIAL * sizeof(hit_object));
+    if (grid->cells == NULL || grid->objects == NULL) {
+        printf("(%s) Couldnt allocate the grid\n", __func__);
+        hit_grid_free(grid);
+        return HIT_ALLOC_FAILED;
+    }
+
+    grid->capacity = HIT_GRID_INITIAL;
+    return HIT_OK;
+}
+
+void hit_grid_free(hit_grid *grid) {
+    if (grid->cells != NULL)
+        for (uint32_t c = 0; c < (uint32_t) grid->cols * grid->rows; c++)
+            free(grid->cells[c].ids);
+    free(grid->cells);
+    free(grid->objects);
+    memset(grid, 0, sizeof(hit_grid));
+}
+
+/*
+ * Returns the cells a rectangle touches, false if it is outside the grid
+ */
+static bool rect_cells(const hit_grid *grid, const sprite_rect *r, uint16_t *c0, uint16_t *r0, uint16_t *c1, uint16_t *r1) {
+
+    int32_t x1 = r->x + r->width, y1 = r->y + r->height;
+    if (r->width == 0 || r->height == 0 || x1 <= 0 || y1 <= 0 || r->x >= grid->width || r->y >= grid->height)
+        return false;
+
+    *c0 = (r->x < 0 ? 0 : r->x / grid->cell_size);
+    *r0 = (r->y < 0 ? 0 : r->y / grid->cell_size);
+    *c1 = (x1 > grid->width ? grid->width - 1 : x1 - 1) / grid->cell_size;
+    *r1 = (y1 > grid->height ? grid->height - 1 : y1 - 1) / grid->cell_size;
+    return true;
+}
+
+static int cell_insert(hit_cell *cell, uint32_t id) {
+
+    if (cell->count == cell->capacity) {
+        uint32_t capacity = (cell->capacity == 0 ? HIT_CELL_INITIAL : 2 * cell->capacity);
+        uint32_t *ids = realloc(cell->ids, capacity * sizeof(uint32_t));
+        if (ids == NULL) {
+            printf("(%s) Couldnt grow a cell to %u objects\n", __func__, capacity);
+            return HIT_ALLOC_FAILED;
+        }
+        cell->ids = ids;
+        cell->capacity = capacity;
+    }
+
+    cell->ids[cell->count++] = id;
+    return HIT_OK;
+}
+
+/*
+ * Replaces an object in a cell with another, or drops it if the other is the last one of the cell
+ */
+static void cell_replace(hit_cell *cell, uint32_t id, uint32_t with, bool drop) {
+    for (uint32_t i = 0; i < cell->count; i++) {
+        if (cell->ids[i] == id) {
+            cell->ids[i] = (drop ? cell->ids[--cell->count] : with);
+            return;
+        }
+    }
+}
+
+static void unlist(hit_grid *grid, uint32_t id) {
+
+    hit_object *o = &grid->objects[id];
+    if (!o->listed)
+        return;
+
+    for (uint16_t r = o->r0; r <= o->r1; r++)
+        for (uint16_t c = o->c0; c <= o->c1; c++)
+            cell_replace(&grid->cells[r * grid->cols + c], id, 0, true);
+    o->listed = false;
+}
+
+static int list(hit_grid *grid, uint32_t id) {
+
+    hit_object *o = &grid->objects[id];
+    if (!rect_cells(grid, &o->bounds, &o->c0, &o->r0, &o->c1, &o->r1))
+        return HIT_OK;
+
+    for (uint16_t r = o->r0; r <= o->r1; r++) {
+        for (uint16_t c = o->c0; c <= o->c1; c++) {
+            if (cell_insert(&grid->cells[r * grid->cols + c], id) != HIT_OK) {
+                /* Take back the cells listed so far, leaving the object unlisted */
+                for (uint16_t br = o->r0; br <= r; br++)
+                    for (uint16_t bc = o->c0; bc <= o->c1 && (br < r || bc < c); bc++)
+                        cell_replace(&grid->cells[br * grid->cols + bc], id, 0, true);
+                return HIT_ALLOC_FAILED;
+            }
+        }
+    }
+
+    o->listed = true;
+    return HIT_OK;
+}
+
+int hit_grid_add(hit_grid *grid, const sprite_rect *bounds, uint16_t depth) {
+
+    if (bounds == NULL) {
+        printf("(%s) Invalid bounds\n", __func__);
+        return -HIT_INVALID_ARGS;
+    }
+
+    if (grid->count == grid->capacity) {
+        hit_object *objects = realloc(grid->objects, 2 * grid->capacity * sizeof(hit_object));
+        if (objects == NULL) {
+            printf("(%s) Couldnt grow the grid to %u objects\n", __func__, 2 * grid->capacity);
+            return -HIT_ALLOC_FAILED;
+        }
+        grid->objects = objects;
+        grid->capacity *= 2;
+    }
+
+    uint32_t i = grid->count;
+    hit_object *o = &grid->objects[i];
+    o->bounds = *bounds;
+    o->depth = depth;
+    o->listed = false;
+    if (list(grid, i) != HIT_OK)
+        return -HIT_ALLOC_FAILED;
+
+    grid->count++;
+    return i;
+}
+
+void hit_grid_remove(hit_grid *grid, uint32_t index) {
+
+    if (index >= grid->count)
+        return;
+
+    unlist(grid, index);
+
+    /* The last object takes the index, in every cell it is listed in */
+    uint32_t last = --grid->count;
+    if (index == last)
+        return;
+
+    hit_object *o = &grid->objects[last];
+    if (o->listed)
+        for (uint16_t r = o->r0; r <= o->r1; r++)
+            for (uint16_t c = o->c0; c <= o->c1; c++)
+                cell_replace(&grid->cells[r * grid->cols + c], last, index, false);
+    grid->objects[index] = *o;
+}
+
+int hit_grid_move(hit_grid *grid, uint32_t index, const sprite_rect *bounds) {
+
+    if (index >= grid->count || bounds == NULL) {
+        printf("(%s) Invalid index or bounds\n", __func__);
+        return HIT_INVALID_ARGS;
+    }
+
+    hit_object *o = &grid->objects[index];
+    uint16_t c0, r0, c1, r1;
+    bool listed = rect_cells(grid, bounds, &c0, &r0, &c1, &r1);
+    o->bounds = *bounds;
+
+    /* Most moves stay within the same cells */
+    if (listed == o->listed && (!listed || (c0 == o->c0 && r0 == o->r0 && c1 == o->c1 && r1 == o->r1)))
+        return HIT_OK;
+
+    unlist(grid, index);
+    return list(grid, index);
+}
+
+static bool rect_contains(const sprite_rect *r, int16_t x, int16_t y) {
+    return x >= r->x && y >= r->y && x < r->x + r->width && y < r->y + r->height;
+}
+
+int hit_grid_at(const hit_grid *grid, int16_t x, int16_t y) {
+
+    if (x < 0 || y < 0 || x >= grid->width || y >= grid->height)
+        return HIT_NONE;
+
+    const hit_cell *cell = &grid->cells[(y / grid->cell_size) * grid->cols + x / grid->cell_size];
+    int hit = HIT_NONE;
+    for (uint32_t i = 0; i < cell->count; i++) {
+        const hit_object *o = &grid->objects[cell->ids[i]];
+        if (rect_contains(&o->bounds, x, y) && (hit == HIT_NONE || o->depth >= grid->objects[hit].depth))
+            hit = cell->ids[i];
+    }
+
+    return hit;
+}
+
+uint32_t hit_grid_query(const hit_grid *grid, const sprite_rect *area, uint32_t *found, uint32_t max) {
+
+    uint16_t c0, r0, c1, r1;
+    if (!rect_cells(grid, area, &c0, &r0, &c1, &r1))
+        return 0;
+
+    uint32_t n = 0;
+    for (uint16_t r = r0; r <= r1; r++) {
+        for (uint16_t c = c0; c <= c1; c++) {
+            const hit_cell *cell = &grid->cells[r * grid->cols + c];
+
+            for (uint32_t i = 0; i < cell->count && n < max; i++) {
+                const sprite_rect *b = &grid->objects[cell->ids[i]].bounds;
+                if (b->x >= area->x + area->width || area->x >= b->x + b->width ||
+                    b->y >= area->y + area->height || area->y >= b->y + b->height)
+                    continue;
+
+                /* Objects spanning several cells are only found in the one holding the corner of the intersection */
+                int16_t x = (b->x > area->x ? b->x : area->x), y = (b->y > area->y ? b->y : area->y);
+                if ((x < 0 ? 0 : x / grid->cell_size) != c || (y < 0 ? 0 : y / grid->cell_size) != r)
+                    continue;
+
+                found[n++] = cell->ids[i];
+            }
+        }
+    }
+
+    return n;
+}
+
+void hit_cursor_move(const hit_grid *grid, int16_t *x, int16_t *y, const struct packet *pp) {
+
+    int32_t nx = *x + pp->delta_x, ny = *y - pp->delta_y;
+
+    if (nx < 0) nx = 0;
+    if (ny < 0) ny = 0;
+    if (nx >= grid->width) nx = grid->width - 1;
+    if (ny >= grid->height) ny = grid->height - 1;
+
+    *x = nx;
+    *y = ny;
+}
@@ -0,0 +1,141 @@
+/*
+ * This file contains the hit testing index of on screen objects.
+ * Bounds are listed in the cells of a uniform grid they touch, updated
+ * as objects move, so a point or rectangle only looks at nearby objects.
+ */
+#ifndef HITGRID_H
+#define HITGRID_H
+
+#include <lcom/lcf.h>
+#include "anim.h"
+
+/* Objects preallocated for a grid and per cell, grown by doubling when needed */
+#define HIT_GRID_INITIAL 256
+#define HIT_CELL_INITIAL 8
+
+/* Returned by hit_grid_at when no object is under the point */
+#define HIT_NONE -1
+
+/* Object indexed by a grid */
+typedef struct {
+    sprite_rect bounds;
+    uint16_t depth; /* Objects of greater depth are hit over the others */
+    bool listed; /* False while the bounds are off the grid */
+    uint16_t c0, r0, c1, r1; /* Cells the object is listed in, when listed */
+} hit_object;
+
+/* Objects touching a cell */
+typedef struct {
+    uint32_t *ids;
+    uint32_t count, capacity;
+} hit_cell;
+
+/* Uniform grid of square cells covering an area */
+typedef struct {
+    uint16_t cell_size;
+    uint16_t cols, rows;
+    uint16_t width, height; /* Size of the area covered */
+    hit_cell *cells;
+    hit_object *objects;
+    uint32_t count, capacity;
+} hit_grid;
+
+/**
+ * @brief Initializes an empty grid covering an area
+ * 
+ * @param grid Address of memory to be initialized
+ * @param width Size in pixels of the area along the x axis
+ * @param height Size in pixels of the area along the y axis
+ * @param cell_size Size in pixels of the side of a cell, about the size of a typical object
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int hit_grid_init(hit_grid *grid, uint16_t width, uint16_t height, uint16_t cell_size);
+
+/**
+ * @brief Frees the buffers of a grid
+ * 
+ * @param grid Grid to free
+ */
+void hit_grid_free(hit_grid *grid);
+
+/**
+ * @brief Adds an object to a grid
+ * 
+ * @param grid Grid to add to
+ * @param bounds Rectangle the object covers
+ * @param depth Objects of greater depth are hit over the others
+ * @return Index of the object, negative upon failure
+ */
+int hit_grid_add(hit_grid *grid, const sprite_rect *bounds, uint16_t depth);
+
+/**
+ * @brief Removes an object from a grid
+ * 
+ * The last object takes its index, as with motion_remove
+ * 
+ * @param grid Grid to remove from
+ * @param index Index of the object
+ */
+void hit_grid_remove(hit_grid *grid, uint32_t index);
+
+/**
+ * @brief Updates the bounds of an object
+ * 
+ * Only moves that change the cells the object touches update the cells
+ * 
+ * @param grid Grid holding the object
+ * @param index Index of the object
+ * @param bounds New rectangle the object covers
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int hit_grid_move(hit_grid *grid, uint32_t index, const sprite_rect *bounds);
+
+/**
+ * @brief Finds the object under a point
+ * 
+ * @param grid Grid to search
+ * @param x Coordinate of the point along the x axis
+ * @param y Coordinate of the point along the y axis
+ * @return Index of the object of greatest depth covering the point, HIT_NONE if there is none
+ */
+int hit_grid_at(const hit_grid *grid, int16_t x, int16_t y);
+
+/**
+ * @brief Finds the objects intersecting a rectangle, as for a marquee selection
+ * 
+ * Each object is found once, in no particular order
+ * 
+ * @param grid Grid to search
+ * @param area Rectangle to intersect
+ * @param found Address of memory to contain the indices of the objects
+ * @param max Number of indices that fit in found
+ * @return Number of indices written to found
+ */
+uint32_t hit_grid_query(const hit_grid *grid, const sprite_rect *area, uint32_t *found, uint32_t max);
+
+/**
+ * @brief Moves a cursor by the displacement of a mouse packet, keeping it inside the grid's area
+ * 
+ * Packets are the ones built by parse_mouse_packet, whose y axis points up
+ * 
+ * @param grid Grid whose area bounds the cursor
+ * @param x Address of memory that contains the coordinate of the cursor along the x axis
+ * @param y Address of memory that contains the coordinate of the cursor along the y axis
+ * @param pp Packet to apply
+ */
+void hit_cursor_move(const hit_grid *grid, int16_t *x, int16_t *y, const struct packet *pp);
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease debugging.
+ */
+typedef enum _hit_status {
+    /* operation was successful */
+    HIT_OK = OK,
+    /* invalid arguments */
+    HIT_INVALID_ARGS,
+    /* failed allocating memory */
+    HIT_ALLOC_FAILED
+} hit_status;
+
+#endif /* end of include guard: HITGRID_H */
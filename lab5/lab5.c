@@ -6,6 +6,9 @@
 #include "keyboard.h"
 #include "i8042.h"
 #include "util.h"
+#include "surface.h"
+#include "anim.h"
+#include "fixed.h"
 
 #include <stdint.h>
 #include <stdio.h>
@@ -290,7 +293,23 @@ int (video_test_xpm)(const char *xpm[], uint16_t x, uint16_t y){
 
 }
 
-int (video_test_move)(const char *xpm[], uint16_t xi, uint16_t yi, uint16_t xf, uint16_t yf, int16_t speed, uint8_t fr_rate){
+/*
+ * Advances a fixed point coordinate by step, stopping at end instead of going past it
+ */
+static fixed_t step_towards(fixed_t position, fixed_t end, fixed_t step){
+    /* Summed in 64 bits, large steps would overflow a fixed_t before being clamped */
+    int64_t next = (int64_t) position + step;
+    if((step > 0 && next > end) || (step < 0 && next < end))
+        return end;
+    return (fixed_t) next;
+}
+
+/*
+ * Moves a pixmap from (xi, yi) to (xf, yf) until ESC is released, advancing velocity pixels
+ * every frame. Velocities are in fixed point, so fractional speeds move smoothly. The only
+ * caller is video_test_move, whose fractional speeds are the 1/N px of a negative speed.
+ */
+static int move_xpm(const char *xpm[], uint16_t xi, uint16_t yi, uint16_t xf, uint16_t yf, fixed_t velocity, uint8_t fr_rate){
 
     /* Guarantee there is only horizontal or vertical movement */
     if(xi != xf && yi != yf){
@@ -321,46 +340,82 @@ int (video_test_move)(const char *xpm[], uint16_t xi, uint16_t yi, uint16_t xf,
     uint8_t scancodes[SCANCODES_BYTES_LEN];
 
     /* Initialize graphics mode */
-    if(vg_init(R1024x768_INDEXED) == NULL)
-		return 1;
+    if(vg_init(R1024x768_INDEXED) == NULL) {
+      printf("(%s) Couldnt set the video mode\n", __func__);
+      timer_unsubscribe_int();
+      keyboard_unsubscribe_int();
+      return 1;
+    }
+
+    /* Present during the vertical retrace so the moving pixmap does not tear */
+    vg_set_present_sync(PRESENT_SYNC_RETRACE);
 
     /* Read the xpm map */
     int width, height;
     char *pixmap = read_xpm(xpm, &width, &height);
     if(pixmap == NULL) {
       printf("(%s) Couldnt read the xpm\n", __func__);
+      timer_unsubscribe_int();
+      keyboard_unsubscribe_int();
+      vg_exit();
       return 1;
     }
 
-    /* Initial coordinates */
-    uint16_t x = xi, y = yi;
-    uint16_t x_dis = 0, y_dis = 0;
+    /* A static pixmap is a sheet with a single frame, placed by its top left corner */
+    surface_t pixmap_surface;
+    surface_wrap(&pixmap_surface, (uint8_t *) pixmap, width, height, BUFFER_NATIVE);
+    sprite_sheet sheet = { .frames = NULL };
+    sprite_rect whole = {0, 0, width, height};
+    if(sprite_sheet_init(&sheet, &pixmap_surface, 0) != ANIM_OK || sprite_sheet_add_frame(&sheet, &whole, 0, 0, 1) < 0) {
+      printf("(%s) Couldnt make a sheet from the xpm\n", __func__);
+      sprite_sheet_free(&sheet);
+      free(pixmap);
+      timer_unsubscribe_int();
+      keyboard_unsubscribe_int();
+      vg_exit();
+      return 1;
+    }
+
+    /* Coordinates and displacement per frame, kept with a fractional part */
+    fixed_t x = INT_TO_FIXED(xi), y = INT_TO_FIXED(yi);
+    fixed_t x_end = INT_TO_FIXED(xf), y_end = INT_TO_FIXED(yf);
+    fixed_t x_dis = 0, y_dis = 0;
 
     /* Calculate x or y displacement */
-    if(xf != x){
-       x_dis = (xf > x ? speed : -speed); 
+    if(xf != xi){
+       x_dis = (xf > xi ? velocity : -velocity);
     }
-    else if(yf != y){
-       y_dis = (yf > y ? speed : -speed); 
+    else if(yf != yi){
+       y_dis = (yf > yi ? velocity : -velocity);
     }
 
     /* 
      * Allocate memory for a backbuffer
      * This is made to ensure no trace is left behind when drawing
      */
-    uint8_t *backbuffer = malloc(get_y_res() * get_x_res());
+    uint8_t *backbuffer = malloc(get_buffer_size());
     if(backbuffer == NULL){
         printf("(%s) Couldnt allocate backbuffer\n", __func__);
+        sprite_sheet_free(&sheet);
+        free(pixmap);
+        timer_unsubscribe_int();
+        keyboard_unsubscribe_int();
+        vg_exit();
         return 1;
     }
+    surface_t back;
+    surface_from_buffer(&back, backbuffer);
+    clear_surface(&back, 0);
+
+    /* Part of the backbuffer covered by the last drawn frame */
+    sprite_rect drawn = {0, 0, 0, 0};
 
     /* Used to keep track of the frames */
-    uint32_t elapsedFrames = 0;
     uint32_t maxInts = sys_hz()/fr_rate;
     uint32_t curInt = 0;
 
     /* Draw the pixmap on the initial position */
-    draw_pixmap(pixmap, x, y, width, height);
+    draw_pixmap(pixmap, xi, yi, width, height);
 
     /* Keep receiving and handling interrupts until the ESC key is released */
     while(!(r == 1 && scancodes[0] == ESC_BREAK)) {
@@ -385,46 +440,14 @@ int (video_test_move)(const char *xpm[], uint16_t xi, uint16_t yi, uint16_t xf,
                         if( (++curInt)%maxInts != 0)
                             continue;
 
-                        /* Only update x and y if not already at the end position */
-                        if( !(yf == y && xf == x) ){
-                            /* Positive speed */
-                            if(speed > 0){
-                                /* X movement */
-                                if(x_dis){
-                                    /* Make sure it does not go beyond the final x */
-                                    if( ((int16_t)(xf - x) * (int16_t)(xf - (x+x_dis))) < 0){
-                                        x_dis = 0;
-                                        x = xf;
-                                    }
-                                    else
-                                        x += x_dis;
-                                }
-                                /* Y movement */
-                                else if (y_dis){
-                                    /* Make sure it does not go beyond the final y */
-                                    if( ((int16_t)(yf - y) * (int16_t)(yf - (y+y_dis))) < 0){
-                                        y_dis = 0;
-                                        y = yf;
-                                    }
-                                    else
-                                        y += y_dis;
-                                }
-                            }
-                           /* Negative speed */
-                            else{
-                                /* Wait 'speed' frames until a 1 px movement */
-                                if( ((++elapsedFrames)%(-speed)) == 0 ){
-                                    if(x_dis)
-                                        x += (xf > x ? 1 : -1);
-                                    else if(y_dis)
-                                        y += (yf > y ? 1 : -1);
-                                }
-                            }
-                        }
-
-                        /* Update pixmap */
-                        clear_buffer(backbuffer, 0);
-                        draw_pixmap_on(pixmap, x, y, width, height, backbuffer);
+                        /* Accumulate the displacement, the fractional part carries over to the next frames */
+                        x = step_towards(x, x_end, x_dis);
+                        y = step_towards(y, y_end, y_dis);
+
+                        /* Update pixmap, only the opaque part of the last frame needs clearing */
+                        draw_rectangle_rop_on(drawn.x, drawn.y, drawn.width, drawn.height, 0, ROP_COPY, &back);
+                        draw_sprite_frame_on(&sheet, 0, FIXED_ROUND(x), FIXED_ROUND(y), &back);
+                        sprite_frame_bounds(&sheet, 0, FIXED_ROUND(x), FIXED_ROUND(y), &drawn);
                         swap_buffers(backbuffer);
                     }
 
@@ -452,16 +475,36 @@ int (video_test_move)(const char *xpm[], uint16_t xi, uint16_t yi, uint16_t xf,
       return 1;
     }
 
-    /* Free allocated memory for backbuffer */
+    /* Free allocated memory for backbuffer and the pixmap */
     free(backbuffer);
+    sprite_sheet_free(&sheet);
+    free(pixmap);
 
     /* Returns to default Minix text mode */
     vg_exit();
+
+    /* Report how long the presents waited for the retrace */
+    const present_stats *stats = get_present_stats();
+    if(stats->frames > 0)
+        printf("(%s) %u frames, waited %u us on average and %u us at most, %u timeouts\n", __func__,
+               stats->frames, (uint32_t) (stats->total_wait_us / stats->frames), stats->max_wait_us, stats->timeouts);
     
     return 0;
 
 }
 
+int (video_test_move)(const char *xpm[], uint16_t xi, uint16_t yi, uint16_t xf, uint16_t yf, int16_t speed, uint8_t fr_rate){
+
+    /* Positive speeds are pixels per frame, negative ones are frames per pixel */
+    fixed_t velocity = 0;
+    if(speed > 0)
+        velocity = INT_TO_FIXED(speed);
+    else if(speed < 0)
+        velocity = FIXED_ONE / -speed;
+
+    return move_xpm(xpm, xi, yi, xf, yf, velocity, fr_rate);
+}
+
 int (video_test_controller)() {
 
     struct reg86u r;
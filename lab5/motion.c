@@ -0,0 +1,227 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "motion.h"
+#include "fixed.h"
+#include "util.h"
+
+/* Eased progress at EASE_TABLE_SIZE + 1 evenly spaced points of each curve */
+static fixed_t ease_table[EASE_COUNT][EASE_TABLE_SIZE + 1];
+static bool ease_table_initialized = false;
+
+static void init_ease_table() {
+
+    for (int32_t i = 0; i <= EASE_TABLE_SIZE; i++) {
+        fixed_t t = i << (FIXED_SHIFT - EASE_TABLE_BITS);
+        fixed_t rest = FIXED_ONE - t;
+
+        ease_table[EASE_LINEAR][i] = t;
+        ease_table[EASE_IN][i] = FIXED_MUL(t, t);
+        ease_table[EASE_OUT][i] = FIXED_ONE - FIXED_MUL(rest, rest);
+        ease_table[EASE_IN_OUT][i] = FIXED_MUL(FIXED_MUL(t, t), 3 * FIXED_ONE - 2 * t);
+
+        /* Half a turn is ANGLE_STEPS / 2, every other point falls between two angles */
+        uint8_t angle = i * (ANGLE_STEPS / 2) / EASE_TABLE_SIZE;
+        fixed_t cosine = fixed_cos(angle);
+        if (i * (ANGLE_STEPS / 2) % EASE_TABLE_SIZE)
+            cosine = (cosine + fixed_cos(angle + 1)) / 2;
+        ease_table[EASE_SINE_IN_OUT][i] = (FIXED_ONE - cosine) / 2;
+
+        ease_table[EASE_STEP][i] = (i == EASE_TABLE_SIZE ? FIXED_ONE : 0);
+    }
+
+    ease_table_initialized = true;
+}
+
+/*
+ * Interpolates between the two table points around t, which must be in [0, FIXED_ONE)
+ */
+static inline fixed_t ease_lookup(ease_curve curve, fixed_t t) {
+    const fixed_t *table = ease_table[curve];
+    uint32_t index = t >> (FIXED_SHIFT - EASE_TABLE_BITS);
+    fixed_t frac = t & ((1 << (FIXED_SHIFT - EASE_TABLE_BITS)) - 1);
+    return table[index] + (fixed_t) (((int64_t) (table[index + 1] - table[index]) * frac) >> (FIXED_SHIFT - EASE_TABLE_BITS));
+}
+
+fixed_t ease(ease_curve curve, fixed_t t) {
+
+    if (!ease_table_initialized)
+        init_ease_table();
+
+    if (t <= 0)
+        return 0;
+    if (t >= FIXED_ONE)
+        return FIXED_ONE;
+
+    /* Steps do not move until the next keyframe is reached */
+    if (curve == EASE_STEP)
+        return 0;
+
+    return ease_lookup(curve, t);
+}
+
+int motion_path_init(motion_path *path, const motion_key *keys, uint16_t count) {
+
+    if (path == NULL || keys == NULL || count == 0 || keys[0].tick != 0) {
+        printf("(%s) Invalid keyframes\n", __func__);
+        return MOTION_INVALID_ARGS;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        if ((i > 0 && keys[i].tick <= keys[i - 1].tick) || keys[i].ease >= EASE_COUNT) {
+            printf("(%s) Invalid keyframe: %d\n", __func__, i);
+            return MOTION_INVALID_ARGS;
+        }
+    }
+
+    if (!ease_table_initialized)
+        init_ease_table();
+
+    path->segments = malloc(count * sizeof(motion_segment));
+    if (path->segments == NULL) {
+        printf("(%s) Couldnt allocate the segments\n", __func__);
+        return MOTION_ALLOC_FAILED;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        motion_segment *s = &path->segments[i];
+        s->tick = keys[i].tick;
+        s->x = keys[i].x;
+        s->y = keys[i].y;
+        s->ease = keys[i].ease;
+
+        /* The last keyframe only holds the end position */
+        if (i + 1 < count) {
+            s->dx = keys[i + 1].x - keys[i].x;
+            s->dy = keys[i + 1].y - keys[i].y;
+            s->inv_length = UINT32_MAX / (keys[i + 1].tick - keys[i].tick);
+        }
+        else {
+            s->dx = s->dy = 0;
+            s->inv_length = 0;
+        }
+    }
+
+    path->count = count;
+    path->duration = keys[count - 1].tick;
+    return MOTION_OK;
+}
+
+void motion_path_free(motion_path *path) {
+    free(path->segments);
+    path->segments = NULL;
+    path->count = 0;
+}
+
+/*
+ * Reallocates every array of a motion set to the given capacity
+ */
+static int motion_set_reserve(motion_set *set, uint32_t capacity) {
+
+    void **arrays[] = {(void **) &set->x, (void **) &set->y, (void **) &set->path, (void **) &set->start, (void **) &set->segment, (void **) &set->flags};
+    static const size_t element_sizes[] = {sizeof(fixed_t), sizeof(fixed_t), sizeof(motion_path *), sizeof(uint32_t), sizeof(uint16_t), sizeof(uint8_t)};
+
+    if (!grow_arrays(arrays, element_sizes, sizeof(element_sizes) / sizeof(element_sizes[0]), capacity)) {
+        printf("(%s) Couldnt grow the motion set to %u sprites\n", __func__, capacity);
+        return MOTION_ALLOC_FAILED;
+    }
+
+    set->capacity = capacity;
+    return MOTION_OK;
+}
+
+int motion_set_init(motion_set *set) {
+
+    if (set == NULL) {
+        printf("(%s) Invalid set\n", __func__);
+        return MOTION_INVALID_ARGS;
+    }
+
+    memset(set, 0, sizeof(motion_set));
+    return motion_set_reserve(set, MOTION_SET_INITIAL);
+}
+
+void motion_set_free(motion_set *set) {
+    free(set->x);
+    free(set->y);
+    free(set->path);
+    free(set->start);
+    free(set->segment);
+    free(set->flags);
+    memset(set, 0, sizeof(motion_set));
+}
+
+int motion_add(motion_set *set, const motion_path *path, uint32_t start, uint8_t flags) {
+
+    if (path == NULL || path->count == 0) {
+        printf("(%s) Invalid path\n", __func__);
+        return -MOTION_INVALID_ARGS;
+    }
+
+    if (set->count == set->capacity && motion_set_reserve(set, 2 * set->capacity) != MOTION_OK)
+        return -MOTION_ALLOC_FAILED;
+
+    uint32_t i = set->count++;
+    set->path[i] = path;
+    set->start[i] = start;
+    set->segment[i] = 0;
+    set->flags[i] = flags & MOTION_LOOP;
+    set->x[i] = path->segments[0].x;
+    set->y[i] = path->segments[0].y;
+    return i;
+}
+
+void motion_remove(motion_set *set, uint32_t index) {
+
+    if (index >= set->count)
+        return;
+
+    uint32_t last = --set->count;
+    set->x[index] = set->x[last];
+    set->y[index] = set->y[last];
+    set->path[index] = set->path[last];
+    set->start[index] = set->start[last];
+    set->segment[index] = set->segment[last];
+    set->flags[index] = set->flags[last];
+}
+
+void motion_update(motion_set *set, uint32_t now) {
+
+    for (uint32_t i = 0; i < set->count; i++) {
+        if (set->flags[i] & MOTION_FINISHED)
+            continue;
+
+        const motion_path *path = set->path[i];
+        const motion_segment *segments = path->segments;
+        uint32_t t = now - set->start[i];
+        uint16_t k = set->segment[i];
+
+        /* Sprites scheduled to start later wait on the first keyframe */
+        if ((int32_t) t < 0)
+            continue;
+
+        /* Past the end, either start over or stay on the last keyframe */
+        if (t >= path->duration) {
+            if (!(set->flags[i] & MOTION_LOOP) || path->duration == 0) {
+                set->x[i] = segments[path->count - 1].x;
+                set->y[i] = segments[path->count - 1].y;
+                set->flags[i] |= MOTION_FINISHED;
+                continue;
+            }
+            set->start[i] += t - t % path->duration;
+            t %= path->duration;
+            k = 0;
+        }
+
+        /* Time only moves forward, so the search resumes at the last segment */
+        while (t >= segments[k + 1].tick)
+            k++;
+        set->segment[i] = k;
+
+        const motion_segment *s = &segments[k];
+        fixed_t progress = (fixed_t) (((uint64_t) (t - s->tick) * s->inv_length) >> (32 - FIXED_SHIFT));
+        fixed_t eased = (s->ease == EASE_STEP ? 0 : ease_lookup(s->ease, progress));
+
+        set->x[i] = s->x + FIXED_MUL(s->dx, eased);
+        set->y[i] = s->y + FIXED_MUL(s->dy, eased);
+    }
+}
@@ -0,0 +1,150 @@
+/*
+ * This file contains the keyframed motion engine.
+ * Sprites follow shared paths, their state kept as one array per field
+ * so a tick walks each array sequentially however many sprites there are.
+ */
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <lcom/lcf.h>
+#include "fixed.h"
+
+/* Easing curves are sampled at this many intervals, values in between are interpolated */
+#define EASE_TABLE_BITS 8
+#define EASE_TABLE_SIZE (1 << EASE_TABLE_BITS)
+
+/* Sprites preallocated for a motion set, grown by doubling when needed */
+#define MOTION_SET_INITIAL 256
+
+/* Sprite flags */
+#define MOTION_LOOP BIT(0) /* Start the path over after its last keyframe */
+#define MOTION_FINISHED BIT(1) /* Reached the last keyframe of a non looping path */
+
+/* How the progress between two keyframes maps to the distance covered */
+typedef enum _ease_curve {
+    EASE_LINEAR = 0,
+    EASE_IN, /* Accelerates from rest */
+    EASE_OUT, /* Decelerates to rest */
+    EASE_IN_OUT, /* Both, smoothstep */
+    EASE_SINE_IN_OUT, /* Both, following half a cosine wave */
+    EASE_STEP, /* Stays put, then jumps at the next keyframe */
+    EASE_COUNT
+} ease_curve;
+
+/* Position a path goes through */
+typedef struct {
+    uint32_t tick; /* Timer interrupts since the start of the path, increasing along it */
+    fixed_t x, y; /* Coordinates in 16.16 fixed point */
+    ease_curve ease; /* Curve of the motion from this keyframe to the next */
+} motion_key;
+
+/* Motion from one keyframe to the next, with everything a tick needs precomputed */
+typedef struct {
+    uint32_t tick; /* Start of the segment */
+    uint32_t inv_length; /* UINT32_MAX divided by the length in ticks, so progress needs no division */
+    fixed_t x, y; /* Start position */
+    fixed_t dx, dy; /* Displacement to the next keyframe */
+    ease_curve ease;
+} motion_segment;
+
+/* Keyframed path, shared by any number of sprites */
+typedef struct {
+    motion_segment *segments; /* One per keyframe, the last one holds the end position */
+    uint16_t count;
+    uint32_t duration; /* Tick of the last keyframe */
+} motion_path;
+
+/* Sprites moving along paths, one array per field */
+typedef struct {
+    uint32_t count, capacity;
+    fixed_t *x, *y; /* Positions after the last update */
+    const motion_path **path;
+    uint32_t *start; /* Timer interrupt count the current run along the path started at */
+    uint16_t *segment; /* Segment reached, so updates resume the search from it */
+    uint8_t *flags;
+} motion_set;
+
+/**
+ * @brief Returns the eased progress between two keyframes, from a table
+ * 
+ * @param curve Easing curve
+ * @param t Linear progress in 16.16 fixed point, from 0 to FIXED_ONE
+ * @return Eased progress in 16.16 fixed point
+ */
+fixed_t ease(ease_curve curve, fixed_t t);
+
+/**
+ * @brief Builds a path from its keyframes
+ * 
+ * @param path Address of memory to be initialized
+ * @param keys Keyframes, the first at tick 0 and the others at increasing ticks
+ * @param count Number of keyframes
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int motion_path_init(motion_path *path, const motion_key *keys, uint16_t count);
+
+/**
+ * @brief Frees a path built with motion_path_init
+ * 
+ * @param path Path to free
+ */
+void motion_path_free(motion_path *path);
+
+/**
+ * @brief Initializes an empty motion set
+ * 
+ * @param set Address of memory to be initialized
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int motion_set_init(motion_set *set);
+
+/**
+ * @brief Frees the arrays of a motion set
+ * 
+ * @param set Set to free
+ */
+void motion_set_free(motion_set *set);
+
+/**
+ * @brief Adds a sprite following a path to a motion set
+ * 
+ * @param set Set to add to
+ * @param path Path to follow, must outlive the sprite
+ * @param start Timer interrupt count the sprite starts at the first keyframe
+ * @param flags MOTION_LOOP to start over after the last keyframe
+ * @return Index of the sprite, negative upon failure
+ */
+int motion_add(motion_set *set, const motion_path *path, uint32_t start, uint8_t flags);
+
+/**
+ * @brief Removes a sprite from a motion set
+ * 
+ * The last sprite takes its index, so the arrays stay packed
+ * 
+ * @param set Set to remove from
+ * @param index Index of the sprite
+ */
+void motion_remove(motion_set *set, uint32_t index);
+
+/**
+ * @brief Moves every sprite of a set to its position at the given time
+ * 
+ * @param set Set to update
+ * @param now Current timer interrupt count
+ */
+void motion_update(motion_set *set, uint32_t now);
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease debugging.
+ */
+typedef enum _motion_status {
+    /* operation was successful */
+    MOTION_OK = OK,
+    /* invalid arguments */
+    MOTION_INVALID_ARGS,
+    /* failed allocating memory */
+    MOTION_ALLOC_FAILED
+} motion_status;
+
+#endif /* end of include guard: MOTION_H */
@@ -0,0 +1,218 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "palette.h"
+
+static palette_color palette[PALETTE_SIZE];
+static bool palette_initialized = false;
+static uint32_t version = 0;
+
+/* Nearest palette entry of each color cell, indexed by the top bits of red, green and blue */
+static uint8_t inverse_cmap[INVERSE_CMAP_SIZE];
+static uint32_t inverse_cmap_dist[INVERSE_CMAP_SIZE]; /* Squared distance to that entry, only used while building */
+static bool inverse_cmap_valid = false;
+static uint32_t inverse_cmap_version;
+
+/* 4x4 Bayer matrix */
+static const uint8_t bayer[DITHER_SIZE][DITHER_SIZE] = {
+    {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}
+};
+
+/* Bayer thresholds turned into component offsets centered on 0 */
+static int8_t dither_offsets[DITHER_SIZE][DITHER_SIZE];
+static bool dither_initialized = false;
+
+/* The 16 EGA colors at the start of the default palette, 6 bits per component */
+static const uint8_t ega_colors[16][3] = {
+    {0, 0, 0}, {0, 0, 42}, {0, 42, 0}, {0, 42, 42}, {42, 0, 0}, {42, 0, 42}, {42, 21, 0}, {42, 42, 42},
+    {21, 21, 21}, {21, 21, 63}, {21, 63, 21}, {21, 63, 63}, {63, 21, 21}, {63, 21, 63}, {63, 63, 21}, {63, 63, 63}
+};
+
+/* Gray ramp that follows them */
+static const uint8_t gray_levels[16] = {0, 5, 8, 11, 14, 17, 20, 24, 28, 32, 36, 40, 45, 50, 56, 63};
+
+/*
+ * The remaining colors come in 9 blocks of 24 hues (3 intensities x 3 saturations).
+ * Each block cycles blue -> red -> green -> blue using these 5 component levels.
+ */
+static const uint8_t hue_levels[9][5] = {
+    {0, 16, 31, 47, 63}, {31, 39, 47, 55, 63}, {45, 49, 54, 58, 63},
+    {0, 7, 14, 21, 28}, {14, 17, 21, 24, 28}, {20, 22, 24, 26, 28},
+    {0, 4, 8, 12, 16}, {8, 10, 12, 14, 16}, {11, 12, 13, 15, 16}
+};
+
+/*
+ * Level indices (red, green, blue) of each of the 24 steps of a hue block
+ */
+static const uint8_t hue_steps[24][3] = {
+    {0, 0, 4}, {1, 0, 4}, {2, 0, 4}, {3, 0, 4}, {4, 0, 4}, {4, 0, 3}, {4, 0, 2}, {4, 0, 1},
+    {4, 0, 0}, {4, 1, 0}, {4, 2, 0}, {4, 3, 0}, {4, 4, 0}, {3, 4, 0}, {2, 4, 0}, {1, 4, 0},
+    {0, 4, 0}, {0, 4, 1}, {0, 4, 2}, {0, 4, 3}, {0, 4, 4}, {0, 3, 4}, {0, 2, 4}, {0, 1, 4}
+};
+
+/*
+ * Converts a 6 bit DAC component to 8 bits, replicating the top bits
+ */
+static uint8_t dac_to_8bit(uint8_t value) {
+    return (value << (8 - DAC_COMPONENT_BITS)) | (value >> (2 * DAC_COMPONENT_BITS - 8));
+}
+
+static void set_dac_color(uint16_t index, uint8_t red, uint8_t green, uint8_t blue) {
+    palette[index].red = dac_to_8bit(red);
+    palette[index].green = dac_to_8bit(green);
+    palette[index].blue = dac_to_8bit(blue);
+}
+
+void palette_reset() {
+    uint16_t index = 0;
+
+    for (uint8_t i = 0; i < 16; i++, index++)
+        set_dac_color(index, ega_colors[i][0], ega_colors[i][1], ega_colors[i][2]);
+
+    for (uint8_t i = 0; i < 16; i++, index++)
+        set_dac_color(index, gray_levels[i], gray_levels[i], gray_levels[i]);
+
+    for (uint8_t block = 0; block < 9; block++)
+        for (uint8_t step = 0; step < 24; step++, index++)
+            set_dac_color(index, hue_levels[block][hue_steps[step][0]], hue_levels[block][hue_steps[step][1]], hue_levels[block][hue_steps[step][2]]);
+
+    /* Last entries are black */
+    for (; index < PALETTE_SIZE; index++)
+        set_dac_color(index, 0, 0, 0);
+
+    palette_initialized = true;
+    version++;
+}
+
+int palette_set_entries(uint8_t first, uint16_t count, const palette_color *colors) {
+
+    if (colors == NULL || first + count > PALETTE_SIZE) {
+        printf("(%s) Invalid palette range: first=%d, count=%d\n", __func__, first, count);
+        return PALETTE_INVALID_ARGS;
+    }
+
+    if (!palette_initialized)
+        palette_reset();
+
+    memcpy(&palette[first], colors, count * sizeof(palette_color));
+    version++;
+
+    return PALETTE_OK;
+}
+
+const palette_color *palette_get() {
+    if (!palette_initialized)
+        palette_reset();
+    return palette;
+}
+
+uint32_t palette_version() {
+    if (!palette_initialized)
+        palette_reset();
+    return version;
+}
+
+/* Shift from an 8 bit component to its inverse colormap cell */
+#define CELL_SHIFT (8 - INVERSE_CMAP_BITS)
+#define CELL_INDEX(r, g, b) ((((r) >> CELL_SHIFT) << (2 * INVERSE_CMAP_BITS)) | (((g) >> CELL_SHIFT) << INVERSE_CMAP_BITS) | ((b) >> CELL_SHIFT))
+
+void palette_build_inverse() {
+
+    const palette_color *colors = palette_get();
+
+    /* Distance from the center of a cell to the next one's is computed incrementally */
+    const int32_t step = 1 << CELL_SHIFT;
+    const int32_t center = step / 2;
+
+    memset(inverse_cmap_dist, 0xFF, sizeof(inverse_cmap_dist));
+
+    /*
+     * Every entry sweeps all cells and claims those it is closer to.
+     * Along blue, (c + step - b)^2 - (c - b)^2 = 2 * step * (c - b) + step^2,
+     * so the inner loop only adds.
+     */
+    for (unsigned entry = 0; entry < PALETTE_SIZE; entry++) {
+        int32_t red = colors[entry].red, green = colors[entry].green, blue = colors[entry].blue;
+        uint32_t index = 0;
+
+        for (int32_t r = center; r < 256; r += step) {
+            int32_t red_dist = (r - red) * (r - red);
+
+            for (int32_t g = center; g < 256; g += step) {
+                int32_t dist = red_dist + (g - green) * (g - green) + (center - blue) * (center - blue);
+                int32_t inc = 2 * step * (center - blue) + step * step;
+
+                for (unsigned b = 0; b < INVERSE_CMAP_SIDE; b++, index++) {
+                    if ((uint32_t) dist < inverse_cmap_dist[index]) {
+                        inverse_cmap_dist[index] = dist;
+                        inverse_cmap[index] = entry;
+                    }
+                    dist += inc;
+                    inc += 2 * step * step;
+                }
+            }
+        }
+    }
+
+    inverse_cmap_valid = true;
+    inverse_cmap_version = palette_version();
+}
+
+/*
+ * Makes sure the inverse colormap matches the current palette
+ */
+static inline void update_inverse() {
+    if (!inverse_cmap_valid || inverse_cmap_version != palette_version())
+        palette_build_inverse();
+}
+
+static void init_dither() {
+    for (uint8_t y = 0; y < DITHER_SIZE; y++)
+        for (uint8_t x = 0; x < DITHER_SIZE; x++)
+            dither_offsets[y][x] = (int8_t) ((2 * bayer[y][x] + 1) * DITHER_SPREAD / (2 * DITHER_SIZE * DITHER_SIZE) - DITHER_SPREAD / 2);
+    dither_initialized = true;
+}
+
+/*
+ * Adds a dither offset to a component, saturating to 0-255
+ */
+static inline uint8_t add_offset(uint8_t value, int8_t offset) {
+    int16_t result = value + offset;
+    return (result < 0 ? 0 : (result > 255 ? 255 : result));
+}
+
+uint8_t palette_nearest(uint8_t red, uint8_t green, uint8_t blue) {
+    update_inverse();
+    return inverse_cmap[CELL_INDEX(red, green, blue)];
+}
+
+uint8_t palette_nearest_dithered(uint8_t red, uint8_t green, uint8_t blue, uint16_t x, uint16_t y) {
+    update_inverse();
+    if (!dither_initialized)
+        init_dither();
+
+    int8_t offset = dither_offsets[y % DITHER_SIZE][x % DITHER_SIZE];
+    return inverse_cmap[CELL_INDEX(add_offset(red, offset), add_offset(green, offset), add_offset(blue, offset))];
+}
+
+void palette_quantize_row(uint8_t *dst, const uint32_t *rgb, uint16_t width, uint16_t x, uint16_t y, bool dither) {
+    update_inverse();
+
+    if (!dither) {
+        for (uint16_t i = 0; i < width; i++) {
+            uint8_t red = rgb[i] >> 16, green = rgb[i] >> 8, blue = rgb[i];
+            dst[i] = inverse_cmap[CELL_INDEX(red, green, blue)];
+        }
+        return;
+    }
+
+    if (!dither_initialized)
+        init_dither();
+
+    /* The matrix row is fixed for the whole row of pixels */
+    const int8_t *offsets = dither_offsets[y % DITHER_SIZE];
+    for (uint16_t i = 0; i < width; i++) {
+        int8_t offset = offsets[(x + i) % DITHER_SIZE];
+        uint8_t red = rgb[i] >> 16, green = rgb[i] >> 8, blue = rgb[i];
+        dst[i] = inverse_cmap[CELL_INDEX(add_offset(red, offset), add_offset(green, offset), add_offset(blue, offset))];
+    }
+}
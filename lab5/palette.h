@@ -0,0 +1,116 @@
+/*
+ * This file contains the 256 color palette used to interpret indexed pixels
+ */
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <lcom/lcf.h>
+
+#define PALETTE_SIZE 256
+
+/* VGA DAC registers hold 6 bits per component */
+#define DAC_COMPONENT_BITS 6
+
+/* Inverse colormap resolution, bits kept of each component */
+#define INVERSE_CMAP_BITS 5
+#define INVERSE_CMAP_SIDE (1 << INVERSE_CMAP_BITS)
+#define INVERSE_CMAP_SIZE (INVERSE_CMAP_SIDE * INVERSE_CMAP_SIDE * INVERSE_CMAP_SIDE)
+
+/* Side of the ordered dither matrix */
+#define DITHER_SIZE 4
+/* Range of the offsets added to each component when dithering, close to the palette's color spacing */
+#define DITHER_SPREAD 32
+
+/* Color of one palette entry, 8 bits per component */
+typedef struct {
+    uint8_t red, green, blue;
+} palette_color;
+
+/**
+ * @brief Restores the default VGA palette, the one XPM pixmaps are drawn with
+ */
+void palette_reset();
+
+/**
+ * @brief Changes consecutive entries of the palette
+ * 
+ * @param first Index of the first entry to change
+ * @param count Number of entries to change
+ * @param colors New colors of the entries
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int palette_set_entries(uint8_t first, uint16_t count, const palette_color *colors);
+
+/**
+ * @brief Returns the current palette
+ * 
+ * @return Array of PALETTE_SIZE colors
+ */
+const palette_color *palette_get();
+
+/**
+ * @brief Returns a counter that changes every time the palette does
+ * 
+ * Lets tables derived from the palette know when to be rebuilt
+ * 
+ * @return Current palette version
+ */
+uint32_t palette_version();
+
+/**
+ * @brief Builds the table that maps colors to their nearest palette entry
+ * 
+ * Done automatically on the first lookup after the palette changes,
+ * call it during startup to keep that cost out of the first frame.
+ */
+void palette_build_inverse();
+
+/**
+ * @brief Returns the palette entry closest to a color
+ * 
+ * @param red Red component, 8 bits
+ * @param green Green component, 8 bits
+ * @param blue Blue component, 8 bits
+ * @return Index of the nearest entry
+ */
+uint8_t palette_nearest(uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * @brief Returns the palette entry for a color with ordered dithering
+ * 
+ * The pixel position selects the dither threshold, so flat areas of an
+ * in-between color become a pattern of nearby entries
+ * 
+ * @param red Red component, 8 bits
+ * @param green Green component, 8 bits
+ * @param blue Blue component, 8 bits
+ * @param x Pixel coordinate along the x axis
+ * @param y Pixel coordinate along the y axis
+ * @return Index of the chosen entry
+ */
+uint8_t palette_nearest_dithered(uint8_t red, uint8_t green, uint8_t blue, uint16_t x, uint16_t y);
+
+/**
+ * @brief Converts a row of true color pixels to palette indices
+ * 
+ * @param dst Row of palette indices to fill
+ * @param rgb Row of 0x00RRGGBB pixels
+ * @param width Number of pixels in the row
+ * @param x Coordinate of the first pixel along the x axis, used for dithering
+ * @param y Coordinate of the row along the y axis, used for dithering
+ * @param dither True to apply ordered dithering
+ */
+void palette_quantize_row(uint8_t *dst, const uint32_t *rgb, uint16_t width, uint16_t x, uint16_t y, bool dither);
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease debugging.
+ */
+typedef enum _palette_status {
+    /* operation was successful */
+    PALETTE_OK = OK,
+    /* invalid arguments */
+    PALETTE_INVALID_ARGS
+} palette_status;
+
+#endif
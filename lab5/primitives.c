@@ -0,0 +1,561 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "primitives.h"
+#include "vbe.h"
+#include "fixed.h"
+#include "blend.h"
+
+/* Linear pixel coverage to blend weight, brightened to approximate gamma 2 */
+static uint8_t coverage_lut[COVERAGE_FULL + 1];
+static bool coverage_lut_initialized = false;
+
+/* Layout of the surface being drawn to */
+typedef struct {
+    surface_t *surface;
+    uint16_t x_res, y_res;
+    uint8_t pixel_size;
+    uint32_t color;
+} target;
+
+static void init_target(target *t, surface_t *surface, uint32_t color) {
+    t->surface = surface;
+    t->color = color;
+    t->x_res = surface->width;
+    t->y_res = surface->height;
+    t->pixel_size = surface->pixel_size;
+}
+
+/*
+ * Fills [x0, x1] on row y, clipped to the target
+ */
+static inline void span(const target *t, int32_t x0, int32_t x1, int32_t y) {
+    if (y < 0 || y >= t->y_res)
+        return;
+    if (x0 < 0)
+        x0 = 0;
+    if (x1 >= t->x_res)
+        x1 = t->x_res - 1;
+    if (x0 > x1)
+        return;
+    fill_pixels(surface_at(t->surface, x0, y), t->color, x1 - x0 + 1, t->pixel_size);
+}
+
+static uint8_t outcode(int32_t x, int32_t y, int32_t x_max, int32_t y_max) {
+    uint8_t code = 0;
+    if (x < 0) code |= OUT_LEFT;
+    else if (x > x_max) code |= OUT_RIGHT;
+    if (y < 0) code |= OUT_TOP;
+    else if (y > y_max) code |= OUT_BOTTOM;
+    return code;
+}
+
+/*
+ * Cohen-Sutherland clipping of a line to [0, x_max] x [0, y_max].
+ * Returns false if the line is entirely outside.
+ */
+static bool clip_line(int32_t *x0, int32_t *y0, int32_t *x1, int32_t *y1, int32_t x_max, int32_t y_max) {
+    uint8_t code0 = outcode(*x0, *y0, x_max, y_max);
+    uint8_t code1 = outcode(*x1, *y1, x_max, y_max);
+
+    while (code0 | code1) {
+        /* Both ends share an outside region */
+        if (code0 & code1)
+            return false;
+
+        /* Move the outside end to the boundary it crosses */
+        uint8_t code = (code0 ? code0 : code1);
+        int64_t dx = *x1 - *x0, dy = *y1 - *y0;
+        int32_t x, y;
+
+        if (code & OUT_TOP) {
+            x = *x0 + (int32_t) (dx * (0 - *y0) / dy);
+            y = 0;
+        }
+        else if (code & OUT_BOTTOM) {
+            x = *x0 + (int32_t) (dx * (y_max - *y0) / dy);
+            y = y_max;
+        }
+        else if (code & OUT_LEFT) {
+            y = *y0 + (int32_t) (dy * (0 - *x0) / dx);
+            x = 0;
+        }
+        else {
+            y = *y0 + (int32_t) (dy * (x_max - *x0) / dx);
+            x = x_max;
+        }
+
+        if (code == code0) {
+            *x0 = x;
+            *y0 = y;
+            code0 = outcode(x, y, x_max, y_max);
+        }
+        else {
+            *x1 = x;
+            *y1 = y;
+            code1 = outcode(x, y, x_max, y_max);
+        }
+    }
+    return true;
+}
+
+int draw_line_on(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint32_t color, surface_t *surface) {
+
+    target t;
+    init_target(&t, surface, color);
+
+    int32_t ax = x0, ay = y0, bx = x1, by = y1;
+    if (!clip_line(&ax, &ay, &bx, &by, t.x_res - 1, t.y_res - 1))
+        return DRAW_OK;
+
+    /* Always walk left to right */
+    if (ax > bx) {
+        int32_t tmp = ax; ax = bx; bx = tmp;
+        tmp = ay; ay = by; by = tmp;
+    }
+
+    int32_t dx = bx - ax, dy = (by > ay ? by - ay : ay - by);
+    int32_t step_y = (by > ay ? 1 : -1);
+
+    if (dx >= dy) {
+        /* Mostly horizontal, each row is a run of pixels drawn as one span */
+        int32_t err = 2 * dy - dx, run_start = ax, y = ay;
+        for (int32_t x = ax; x < bx; x++) {
+            if (err > 0) {
+                span(&t, run_start, x, y);
+                run_start = x + 1;
+                y += step_y;
+                err -= 2 * dx;
+            }
+            err += 2 * dy;
+        }
+        span(&t, run_start, bx, y);
+    }
+    else {
+        /* Mostly vertical, one pixel per row */
+        int32_t err = 2 * dx - dy, x = ax;
+        for (int32_t y = ay; y != by + step_y; y += step_y) {
+            span(&t, x, x, y);
+            if (err > 0) {
+                x++;
+                err -= 2 * dy;
+            }
+            err += 2 * dx;
+        }
+    }
+
+    vg_target_modified(surface->pixels);
+    return DRAW_OK;
+}
+
+/*
+ * Plots the 4 symmetric points of an ellipse or circle octant
+ */
+static inline void plot_symmetric(const target *t, int32_t cx, int32_t cy, int32_t x, int32_t y) {
+    span(t, cx + x, cx + x, cy + y);
+    span(t, cx - x, cx - x, cy + y);
+    span(t, cx + x, cx + x, cy - y);
+    span(t, cx - x, cx - x, cy - y);
+}
+
+/*
+ * Midpoint circle outline, one octant computed and mirrored to the other 7
+ */
+static void rasterize_circle(const target *t, int32_t cx, int32_t cy, int32_t radius) {
+    int32_t x = radius, y = 0, err = 1 - radius;
+
+    while (x >= y) {
+        plot_symmetric(t, cx, cy, x, y);
+        plot_symmetric(t, cx, cy, y, x);
+
+        y++;
+        if (err < 0)
+            err += 2 * y + 1;
+        else {
+            x--;
+            err += 2 * (y - x) + 1;
+        }
+    }
+}
+
+/*
+ * Draws the row pair +-y of an ellipse, as points or as a span
+ */
+static inline void ellipse_rows(const target *t, int32_t cx, int32_t cy, int32_t x, int32_t y, bool filled) {
+    if (filled) {
+        span(t, cx - x, cx + x, cy + y);
+        if (y != 0)
+            span(t, cx - x, cx + x, cy - y);
+    }
+    else
+        plot_symmetric(t, cx, cy, x, y);
+}
+
+/*
+ * Midpoint ellipse in two regions, where the slope is above and below -1.
+ * Filled ellipses draw each row pair once, at its widest point.
+ */
+static void rasterize_ellipse(const target *t, int32_t cx, int32_t cy, int32_t rx, int32_t ry, bool filled) {
+
+    /* Degenerate ellipses are lines */
+    if (rx == 0 || ry == 0) {
+        for (int32_t y = -ry; y <= ry; y++)
+            span(t, cx - rx, cx + rx, cy + y);
+        return;
+    }
+
+    int64_t rx2 = (int64_t) rx * rx, ry2 = (int64_t) ry * ry;
+    int32_t x = 0, y = ry;
+    int64_t dx = 0, dy = 2 * rx2 * y;
+
+    /* Region 1, x advances every step */
+    int64_t p = ry2 - rx2 * ry + rx2 / 4;
+    while (dx < dy) {
+        if (!filled)
+            plot_symmetric(t, cx, cy, x, y);
+
+        x++;
+        dx += 2 * ry2;
+        if (p < 0)
+            p += dx + ry2;
+        else {
+            /* Leaving row y, x - 1 was its widest point */
+            if (filled)
+                ellipse_rows(t, cx, cy, x - 1, y, true);
+            y--;
+            dy -= 2 * rx2;
+            p += dx - dy + ry2;
+        }
+    }
+
+    /* Region 2, y decreases every step */
+    p = ry2 * (2 * (int64_t) x + 1) * (2 * (int64_t) x + 1) / 4 + rx2 * (int64_t) (y - 1) * (y - 1) - rx2 * ry2;
+    while (y >= 0) {
+        ellipse_rows(t, cx, cy, x, y, filled);
+
+        y--;
+        dy -= 2 * rx2;
+        if (p > 0)
+            p += rx2 - dy;
+        else {
+            x++;
+            dx += 2 * ry2;
+            p += dx - dy + rx2;
+        }
+    }
+}
+
+int draw_circle_on(int16_t cx, int16_t cy, uint16_t radius, uint32_t color, surface_t *surface) {
+    target t;
+    init_target(&t, surface, color);
+    rasterize_circle(&t, cx, cy, radius);
+    vg_target_modified(surface->pixels);
+    return DRAW_OK;
+}
+
+int fill_circle_on(int16_t cx, int16_t cy, uint16_t radius, uint32_t color, surface_t *surface) {
+    target t;
+    init_target(&t, surface, color);
+    rasterize_ellipse(&t, cx, cy, radius, radius, true);
+    vg_target_modified(surface->pixels);
+    return DRAW_OK;
+}
+
+int draw_ellipse_on(int16_t cx, int16_t cy, uint16_t rx, uint16_t ry, uint32_t color, surface_t *surface) {
+    target t;
+    init_target(&t, surface, color);
+    rasterize_ellipse(&t, cx, cy, rx, ry, false);
+    vg_target_modified(surface->pixels);
+    return DRAW_OK;
+}
+
+int fill_ellipse_on(int16_t cx, int16_t cy, uint16_t rx, uint16_t ry, uint32_t color, surface_t *surface) {
+    target t;
+    init_target(&t, surface, color);
+    rasterize_ellipse(&t, cx, cy, rx, ry, true);
+    vg_target_modified(surface->pixels);
+    return DRAW_OK;
+}
+
+int draw_polygon_on(const point *points, uint16_t count, uint32_t color, surface_t *surface) {
+
+    if (points == NULL || count < 2) {
+        printf("(%s) A polygon needs at least 2 points\n", __func__);
+        return DRAW_INVALID_ARGS;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        const point *a = &points[i], *b = &points[(i + 1) % count];
+        draw_line_on(a->x, a->y, b->x, b->y, color, surface);
+    }
+    return DRAW_OK;
+}
+
+/* Non horizontal polygon edge, in the edge table */
+typedef struct {
+    int32_t y_min, y_max; /* Rows [y_min, y_max) whose centers the edge crosses */
+    fixed_t x; /* Crossing at the current row's center */
+    fixed_t dx_dy; /* Change of x per row */
+} edge;
+
+int fill_polygon_on(const point *points, uint16_t count, uint32_t color, surface_t *surface) {
+
+    if (points == NULL || count < 3) {
+        printf("(%s) A polygon needs at least 3 points\n", __func__);
+        return DRAW_INVALID_ARGS;
+    }
+
+    target t;
+    init_target(&t, surface, color);
+
+    edge *edges = malloc(count * sizeof(edge));
+    fixed_t *crossings = malloc(count * sizeof(fixed_t));
+    if (edges == NULL || crossings == NULL) {
+        free(edges);
+        free(crossings);
+        printf("(%s) Couldnt allocate the edge table\n", __func__);
+        return DRAW_ALLOC_FAILED;
+    }
+
+    /* Build the edge table, sorted by first row with an insertion sort */
+    uint16_t edge_count = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        const point *a = &points[i], *b = &points[(i + 1) % count];
+        if (a->y == b->y)
+            continue;
+        if (a->y > b->y) {
+            const point *tmp = a; a = b; b = tmp;
+        }
+
+        edge e;
+        e.y_min = a->y;
+        e.y_max = b->y;
+        e.dx_dy = FIXED_DIV(b->x - a->x, b->y - a->y);
+        e.x = INT_TO_FIXED(a->x) + e.dx_dy / 2;
+
+        uint16_t j = edge_count++;
+        for (; j > 0 && edges[j - 1].y_min > e.y_min; j--)
+            edges[j] = edges[j - 1];
+        edges[j] = e;
+    }
+
+    int32_t y_start = (edge_count ? edges[0].y_min : 0), y_end = y_start;
+    for (uint16_t i = 0; i < edge_count; i++)
+        if (edges[i].y_max > y_end)
+            y_end = edges[i].y_max;
+    if (y_end > t.y_res)
+        y_end = t.y_res;
+
+    /* Edges [first_active, next_edge) may be active on the current row */
+    uint16_t first_active = 0, next_edge = 0;
+    for (int32_t y = y_start; y < y_end; y++) {
+        while (next_edge < edge_count && edges[next_edge].y_min <= y)
+            next_edge++;
+        /* Finished edges at the front are retired, later ones are skipped below */
+        while (first_active < next_edge && edges[first_active].y_max <= y)
+            first_active++;
+
+        /* Gather this row's crossings, sorted */
+        uint16_t crossing_count = 0;
+        for (uint16_t i = first_active; i < next_edge; i++) {
+            edge *e = &edges[i];
+            if (e->y_max <= y)
+                continue;
+
+            uint16_t j = crossing_count++;
+            for (; j > 0 && crossings[j - 1] > e->x; j--)
+                crossings[j] = crossings[j - 1];
+            crossings[j] = e->x;
+            e->x += e->dx_dy;
+        }
+
+        if (y < 0)
+            continue;
+
+        /* Fill the pixels whose centers lie between pairs of crossings */
+        for (uint16_t i = 0; i + 1 < crossing_count; i += 2) {
+            int32_t x0 = FIXED_TO_INT(crossings[i] + FIXED_HALF - 1);
+            int32_t x1 = FIXED_TO_INT(crossings[i + 1] + FIXED_HALF - 1) - 1;
+            span(&t, x0, x1, y);
+        }
+    }
+
+    free(edges);
+    free(crossings);
+
+    vg_target_modified(surface->pixels);
+    return DRAW_OK;
+}
+
+/*
+ * Integer square root, rounded down
+ */
+static uint32_t isqrt(uint64_t value) {
+    uint64_t result = 0, bit = (uint64_t) 1 << 62;
+
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+            result >>= 1;
+        bit >>= 2;
+    }
+    return (uint32_t) result;
+}
+
+/*
+ * Blend weights are (coverage / 255)^(1/2) * 255, so partial pixels do not look too dim
+ */
+static void init_coverage_lut() {
+    for (uint32_t c = 0; c <= COVERAGE_FULL; c++)
+        coverage_lut[c] = (uint8_t) isqrt(c * COVERAGE_FULL);
+    coverage_lut_initialized = true;
+}
+
+/*
+ * Prepares an anti-aliased draw, which needs a direct color target
+ */
+static bool init_aa_target(target *t, surface_t *surface, uint32_t rgb) {
+    init_target(t, surface, vg_pack_rgb(rgb >> 16, rgb >> 8, rgb));
+
+    if (!blend_supported() || surface->format != BUFFER_NATIVE) {
+        printf("(%s) Anti-aliasing needs a direct color surface\n", __func__);
+        return false;
+    }
+
+    if (!coverage_lut_initialized)
+        init_coverage_lut();
+    return true;
+}
+
+/*
+ * Blends the color over pixel (x, y) with the given coverage, if inside the target
+ */
+static inline void plot_coverage(const target *t, int32_t x, int32_t y, uint32_t rgb, uint8_t coverage) {
+    if (x < 0 || y < 0 || x >= t->x_res || y >= t->y_res || coverage == 0)
+        return;
+
+    uint32_t argb = ((uint32_t) coverage_lut[coverage] << ALPHA_SHIFT) | (rgb & 0xFFFFFF);
+    blend_span(surface_at(t->surface, x, y), &argb, 1);
+}
+
+int draw_line_aa_on(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint32_t rgb, surface_t *surface) {
+
+    target t;
+    if (!init_aa_target(&t, surface, rgb))
+        return DRAW_INVALID_COLOR_MODE;
+
+    /* Walk along the major axis, swapping coordinates for steep lines */
+    bool steep = abs(y1 - y0) > abs(x1 - x0);
+    int32_t a0 = (steep ? y0 : x0), b0 = (steep ? x0 : y0);
+    int32_t a1 = (steep ? y1 : x1), b1 = (steep ? x1 : y1);
+    if (a0 > a1) {
+        int32_t tmp = a0; a0 = a1; a1 = tmp;
+        tmp = b0; b0 = b1; b1 = tmp;
+    }
+
+    fixed_t gradient = (a1 == a0 ? 0 : FIXED_DIV(b1 - b0, a1 - a0));
+
+    /* Clip the major axis once, the minor one is checked per pixel */
+    int32_t a_limit = (steep ? t.y_res : t.x_res) - 1;
+    int32_t a_start = (a0 < 0 ? 0 : a0), a_end = (a1 > a_limit ? a_limit : a1);
+    fixed_t b = INT_TO_FIXED(b0) + (fixed_t) ((int64_t) (a_start - a0) * gradient);
+
+    for (int32_t a = a_start; a <= a_end; a++, b += gradient) {
+        int32_t b_int = FIXED_TO_INT(b);
+        uint8_t coverage = FIXED_FRAC(b) >> (FIXED_SHIFT - COVERAGE_BITS);
+
+        /* The line's intensity is split between the two pixels it passes between */
+        if (steep) {
+            plot_coverage(&t, b_int, a, rgb, COVERAGE_FULL - coverage);
+            plot_coverage(&t, b_int + 1, a, rgb, coverage);
+        }
+        else {
+            plot_coverage(&t, a, b_int, rgb, COVERAGE_FULL - coverage);
+            plot_coverage(&t, a, b_int + 1, rgb, coverage);
+        }
+    }
+
+    vg_target_modified(surface->pixels);
+    return DRAW_OK;
+}
+
+/*
+ * Distance from the center to the circle at offset (i + 0.5) along the other axis, in 8.8 fixed point
+ */
+static inline uint32_t circle_extent(uint32_t radius, uint32_t i) {
+    int64_t quarter_units = 4 * (int64_t) radius * radius - (int64_t) (2 * i + 1) * (2 * i + 1);
+    return (quarter_units <= 0 ? 0 : isqrt((uint64_t) quarter_units << (2 * COVERAGE_BITS - 2)));
+}
+
+/*
+ * Blends the 8 symmetric pixels of quadrant offsets (i, j) and (j, i).
+ * Offset i covers [i, i + 1) from the center, pixel cx + i on one side and cx - 1 - i on the other.
+ */
+static inline void plot_octants(const target *t, int32_t cx, int32_t cy, int32_t i, int32_t j, uint32_t rgb, uint8_t coverage) {
+    plot_coverage(t, cx + i, cy + j, rgb, coverage);
+    plot_coverage(t, cx - 1 - i, cy + j, rgb, coverage);
+    plot_coverage(t, cx + i, cy - 1 - j, rgb, coverage);
+    plot_coverage(t, cx - 1 - i, cy - 1 - j, rgb, coverage);
+    if (i == j)
+        return;
+    plot_coverage(t, cx + j, cy + i, rgb, coverage);
+    plot_coverage(t, cx - 1 - j, cy + i, rgb, coverage);
+    plot_coverage(t, cx + j, cy - 1 - i, rgb, coverage);
+    plot_coverage(t, cx - 1 - j, cy - 1 - i, rgb, coverage);
+}
+
+int draw_circle_aa_on(int16_t cx, int16_t cy, uint16_t radius, uint32_t rgb, surface_t *surface) {
+
+    target t;
+    if (!init_aa_target(&t, surface, rgb))
+        return DRAW_INVALID_COLOR_MODE;
+
+    /* One octant, columns up to the diagonal, the circle split between the two nearest pixels */
+    for (int32_t i = 0; ; i++) {
+        uint32_t extent = circle_extent(radius, i);
+        int32_t center = (int32_t) extent - (1 << (COVERAGE_BITS - 1));
+        int32_t j = center >> COVERAGE_BITS;
+        if (j + 1 < i)
+            break;
+
+        /* Past the diagonal only the outer pixel is still missing from the other octant */
+        uint8_t coverage = center & COVERAGE_FULL;
+        if (j >= i)
+            plot_octants(&t, cx, cy, i, j, rgb, COVERAGE_FULL - coverage);
+        plot_octants(&t, cx, cy, i, j + 1, rgb, coverage);
+    }
+
+    vg_target_modified(surface->pixels);
+    return DRAW_OK;
+}
+
+int fill_circle_aa_on(int16_t cx, int16_t cy, uint16_t radius, uint32_t rgb, surface_t *surface) {
+
+    target t;
+    if (!init_aa_target(&t, surface, rgb))
+        return DRAW_INVALID_COLOR_MODE;
+
+    for (int32_t j = 0; j < radius; j++) {
+        uint32_t extent = circle_extent(radius, j);
+        int32_t full = extent >> COVERAGE_BITS;
+
+        /* Pixels entirely inside the circle */
+        span(&t, cx - full, cx + full - 1, cy + j);
+        span(&t, cx - full, cx + full - 1, cy - 1 - j);
+
+        /*
+         * The partially covered pixel at the end of the row, or of the column
+         * when mirrored, while the edge is steeper than the diagonal
+         */
+        if (full >= j)
+            plot_octants(&t, cx, cy, j, full, rgb, extent & COVERAGE_FULL);
+    }
+
+    vg_target_modified(surface->pixels);
+    return DRAW_OK;
+}
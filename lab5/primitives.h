@@ -0,0 +1,169 @@
+/*
+ * This file contains the line, circle, ellipse and polygon rasterizers.
+ * Every shape is drawn as horizontal spans through fill_pixels.
+ */
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+#include <lcom/lcf.h>
+#include "vbe.h"
+
+/* Cohen-Sutherland outcodes */
+#define OUT_LEFT BIT(0)
+#define OUT_RIGHT BIT(1)
+#define OUT_TOP BIT(2)
+#define OUT_BOTTOM BIT(3)
+
+/* Anti-aliasing coverage is kept in 8 bits */
+#define COVERAGE_BITS 8
+#define COVERAGE_FULL ((1 << COVERAGE_BITS) - 1)
+
+/* Vertex of a polygon */
+typedef struct {
+    int16_t x, y;
+} point;
+
+/**
+ * @brief Draws a line between two points, clipped to the surface
+ * 
+ * @param x0 First point coordinate along the x axis, may be off the surface
+ * @param y0 First point coordinate along the y axis, may be off the surface
+ * @param x1 Second point coordinate along the x axis, may be off the surface
+ * @param y1 Second point coordinate along the y axis, may be off the surface
+ * @param color Color in the surface's pixel format
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_line_on(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint32_t color, surface_t *surface);
+
+/**
+ * @brief Draws the outline of a circle
+ * 
+ * @param cx Center coordinate along the x axis
+ * @param cy Center coordinate along the y axis
+ * @param radius Radius in pixels
+ * @param color Color in the surface's pixel format
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_circle_on(int16_t cx, int16_t cy, uint16_t radius, uint32_t color, surface_t *surface);
+
+/**
+ * @brief Draws a filled circle
+ * 
+ * @param cx Center coordinate along the x axis
+ * @param cy Center coordinate along the y axis
+ * @param radius Radius in pixels
+ * @param color Color in the surface's pixel format
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int fill_circle_on(int16_t cx, int16_t cy, uint16_t radius, uint32_t color, surface_t *surface);
+
+/**
+ * @brief Draws the outline of an axis aligned ellipse
+ * 
+ * @param cx Center coordinate along the x axis
+ * @param cy Center coordinate along the y axis
+ * @param rx Radius along the x axis
+ * @param ry Radius along the y axis
+ * @param color Color in the surface's pixel format
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_ellipse_on(int16_t cx, int16_t cy, uint16_t rx, uint16_t ry, uint32_t color, surface_t *surface);
+
+/**
+ * @brief Draws a filled axis aligned ellipse
+ * 
+ * @param cx Center coordinate along the x axis
+ * @param cy Center coordinate along the y axis
+ * @param rx Radius along the x axis
+ * @param ry Radius along the y axis
+ * @param color Color in the surface's pixel format
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int fill_ellipse_on(int16_t cx, int16_t cy, uint16_t rx, uint16_t ry, uint32_t color, surface_t *surface);
+
+/**
+ * @brief Draws the outline of a closed polygon
+ * 
+ * @param points Vertices of the polygon
+ * @param count Number of vertices
+ * @param color Color in the surface's pixel format
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_polygon_on(const point *points, uint16_t count, uint32_t color, surface_t *surface);
+
+/**
+ * @brief Draws a filled polygon, convex or concave, using the even-odd rule
+ * 
+ * @param points Vertices of the polygon
+ * @param count Number of vertices
+ * @param color Color in the surface's pixel format
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int fill_polygon_on(const point *points, uint16_t count, uint32_t color, surface_t *surface);
+
+/**
+ * @brief Draws an anti-aliased line between two points (Wu's algorithm)
+ * 
+ * Only available in direct color modes, on surfaces in the native format
+ * 
+ * @param x0 First point coordinate along the x axis, may be off the surface
+ * @param y0 First point coordinate along the y axis, may be off the surface
+ * @param x1 Second point coordinate along the x axis, may be off the surface
+ * @param y1 Second point coordinate along the y axis, may be off the surface
+ * @param rgb Color as 0x00RRGGBB
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_line_aa_on(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint32_t rgb, surface_t *surface);
+
+/**
+ * @brief Draws the anti-aliased outline of a circle
+ * 
+ * The center is the corner between pixels (cx - 1, cy - 1) and (cx, cy)
+ * 
+ * @param cx Center coordinate along the x axis
+ * @param cy Center coordinate along the y axis
+ * @param radius Radius in pixels
+ * @param rgb Color as 0x00RRGGBB
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_circle_aa_on(int16_t cx, int16_t cy, uint16_t radius, uint32_t rgb, surface_t *surface);
+
+/**
+ * @brief Draws a filled circle with anti-aliased edges
+ * 
+ * The center is the corner between pixels (cx - 1, cy - 1) and (cx, cy)
+ * 
+ * @param cx Center coordinate along the x axis
+ * @param cy Center coordinate along the y axis
+ * @param radius Radius in pixels
+ * @param rgb Color as 0x00RRGGBB
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int fill_circle_aa_on(int16_t cx, int16_t cy, uint16_t radius, uint32_t rgb, surface_t *surface);
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease development and debugging
+ */
+typedef enum _draw_status {
+    DRAW_OK = OK,
+
+    /* invalid arguments on a function */
+    DRAW_INVALID_ARGS,
+    /* failed allocating memory */
+    DRAW_ALLOC_FAILED,
+    /* the target's pixel format can not be drawn to */
+    DRAW_INVALID_COLOR_MODE
+} draw_status;
+
+#endif
@@ -0,0 +1,231 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "sprite.h"
+#include "vbe.h"
+#include "palette.h"
+
+/*
+ * Intersects [x, x + width) x [y, y + height) with the target.
+ * Returns false if nothing is left.
+ */
+static bool clip_rect(int32_t x, int32_t y, int32_t width, int32_t height, uint16_t x_res, uint16_t y_res,
+                      int32_t *x0, int32_t *y0, int32_t *x1, int32_t *y1) {
+    *x0 = (x < 0 ? 0 : x);
+    *y0 = (y < 0 ? 0 : y);
+    *x1 = (x + width > x_res ? x_res : x + width);
+    *y1 = (y + height > y_res ? y_res : y + height);
+    return *x0 < *x1 && *y0 < *y1;
+}
+
+/*
+ * Narrows [*lo, *hi) to the steps i for which 0 <= start + i * step < limit
+ */
+static void clip_span(fixed_t start, fixed_t step, fixed_t limit, int32_t *lo, int32_t *hi) {
+    int64_t first, last;
+
+    if (step == 0) {
+        if (start < 0 || start >= limit)
+            *hi = *lo;
+        return;
+    }
+
+    /* Solve start + i * step >= 0 and start + i * step <= limit - 1 */
+    if (step > 0) {
+        first = -floor_div(start, step);
+        last = floor_div((int64_t) limit - 1 - start, step);
+    }
+    else {
+        first = -floor_div(-((int64_t) limit - 1 - start), step);
+        last = floor_div(-(int64_t) start, step);
+    }
+
+    if (first > *lo)
+        *lo = (int32_t) first;
+    if (last + 1 < *hi)
+        *hi = (int32_t) (last + 1);
+    if (*hi < *lo)
+        *hi = *lo;
+}
+
+int draw_pixmap_scaled_on(const char *pixmap, int width, int height, int16_t x, int16_t y, uint16_t dst_width, uint16_t dst_height, surface_t *surface) {
+
+    if (pixmap == NULL || width <= 0 || height <= 0) {
+        printf("(%s) Invalid pixmap\n", __func__);
+        return SPRITE_INVALID_ARGS;
+    }
+
+    uint16_t x_res = surface->width, y_res = surface->height;
+    uint8_t pixel_size = surface->pixel_size;
+
+    /* Clipping is done once, the loops below never test bounds */
+    int32_t x0, y0, x1, y1;
+    if (!clip_rect(x, y, dst_width, dst_height, x_res, y_res, &x0, &y0, &x1, &y1))
+        return SPRITE_OK;
+
+    /* Source pixels per destination pixel, sampling at pixel centers */
+    fixed_t step_x = FIXED_DIV(width, dst_width);
+    fixed_t step_y = FIXED_DIV(height, dst_height);
+    fixed_t u_start = (fixed_t) ((int64_t) (x0 - x) * step_x) + step_x / 2;
+    fixed_t v = (fixed_t) ((int64_t) (y0 - y) * step_y) + step_y / 2;
+
+    const uint8_t *src = (const uint8_t *) pixmap;
+    for (int32_t row = y0; row < y1; row++, v += step_y) {
+        const uint8_t *src_row = src + (size_t) FIXED_TO_INT(v) * width * pixel_size;
+        uint8_t *dst = surface_at(surface, x0, row);
+        fixed_t u = u_start;
+
+        switch (pixel_size) {
+            case 1:
+                for (int32_t i = 0; i < x1 - x0; i++, u += step_x)
+                    dst[i] = src_row[FIXED_TO_INT(u)];
+                break;
+            case 2:
+                for (int32_t i = 0; i < x1 - x0; i++, u += step_x)
+                    ((uint16_t *) dst)[i] = ((const uint16_t *) src_row)[FIXED_TO_INT(u)];
+                break;
+            case 4:
+                for (int32_t i = 0; i < x1 - x0; i++, u += step_x)
+                    ((uint32_t *) dst)[i] = ((const uint32_t *) src_row)[FIXED_TO_INT(u)];
+                break;
+            default:
+                for (int32_t i = 0; i < x1 - x0; i++, u += step_x)
+                    memcpy(dst + i * pixel_size, src_row + FIXED_TO_INT(u) * pixel_size, pixel_size);
+                break;
+        }
+    }
+
+    vg_target_modified(surface->pixels);
+    return SPRITE_OK;
+}
+
+/*
+ * Interpolates two 0x00RRGGBB pixels, weight from 0 (all a) to 256 (all b).
+ * Red and blue are interpolated together, as are alpha and green.
+ */
+static inline uint32_t lerp_pixel(uint32_t a, uint32_t b, uint32_t weight) {
+    uint32_t rb = (((a & 0xFF00FF) * (256 - weight) + (b & 0xFF00FF) * weight) >> 8) & 0xFF00FF;
+    uint32_t ag = (((a >> 8) & 0xFF00FF) * (256 - weight) + ((b >> 8) & 0xFF00FF) * weight) & 0xFF00FF00;
+    return rb | ag;
+}
+
+/*
+ * Clamps a 16.16 sample coordinate to [0, size - 1]
+ */
+static inline fixed_t clamp_sample(fixed_t value, int size) {
+    if (value < 0)
+        return 0;
+    if (value > INT_TO_FIXED(size - 1))
+        return INT_TO_FIXED(size - 1);
+    return value;
+}
+
+int draw_image_scaled_bilinear_on(const uint32_t *image, int width, int height, int16_t x, int16_t y, uint16_t dst_width, uint16_t dst_height, surface_t *surface) {
+
+    if (image == NULL || width <= 0 || height <= 0) {
+        printf("(%s) Invalid image\n", __func__);
+        return SPRITE_INVALID_ARGS;
+    }
+
+    uint16_t x_res = surface->width, y_res = surface->height;
+    uint8_t pixel_size = surface->pixel_size;
+
+    int32_t x0, y0, x1, y1;
+    if (!clip_rect(x, y, dst_width, dst_height, x_res, y_res, &x0, &y0, &x1, &y1))
+        return SPRITE_OK;
+
+    /* 32 bit targets with 8 bits per component take the interpolated pixel as is */
+    bool rgb_8888 = (pixel_size == 4 && get_red_field_position() == 16 && get_green_field_position() == 8 && get_blue_field_position() == 0);
+
+    /* Sample positions are pixel centers mapped back to the source */
+    fixed_t step_x = FIXED_DIV(width, dst_width);
+    fixed_t step_y = FIXED_DIV(height, dst_height);
+    fixed_t u_start = (fixed_t) ((int64_t) (x0 - x) * step_x) + step_x / 2 - FIXED_HALF;
+    fixed_t v = (fixed_t) ((int64_t) (y0 - y) * step_y) + step_y / 2 - FIXED_HALF;
+
+    for (int32_t row = y0; row < y1; row++, v += step_y) {
+        fixed_t sample_v = clamp_sample(v, height);
+        int src_y = FIXED_TO_INT(sample_v);
+        uint32_t weight_y = FIXED_FRAC(sample_v) >> 8;
+        const uint32_t *top = image + (size_t) src_y * width;
+        const uint32_t *bottom = (src_y + 1 < height ? top + width : top);
+
+        uint8_t *dst = surface_at(surface, x0, row);
+        fixed_t u = u_start;
+
+        for (int32_t i = 0; i < x1 - x0; i++, u += step_x, dst += pixel_size) {
+            fixed_t sample_u = clamp_sample(u, width);
+            int left = FIXED_TO_INT(sample_u);
+            int right = (left + 1 < width ? left + 1 : left);
+            uint32_t weight_x = FIXED_FRAC(sample_u) >> 8;
+
+            uint32_t color = lerp_pixel(lerp_pixel(top[left], top[right], weight_x),
+                                        lerp_pixel(bottom[left], bottom[right], weight_x), weight_y);
+
+            if (rgb_8888)
+                *(uint32_t *) dst = color;
+            else if (pixel_size == 1)
+                *dst = palette_nearest(color >> 16, color >> 8, color);
+            else {
+                uint32_t packed = vg_pack_rgb(color >> 16, color >> 8, color);
+                memcpy(dst, &packed, pixel_size);
+            }
+        }
+    }
+
+    vg_target_modified(surface->pixels);
+    return SPRITE_OK;
+}
+
+int draw_pixmap_rotated_on(const char *pixmap, int width, int height, int16_t cx, int16_t cy, uint8_t angle, fixed_t scale, surface_t *surface) {
+
+    if (pixmap == NULL || width <= 0 || height <= 0 || scale <= 0) {
+        printf("(%s) Invalid pixmap or scale\n", __func__);
+        return SPRITE_INVALID_ARGS;
+    }
+
+    uint16_t x_res = surface->width, y_res = surface->height;
+    uint8_t pixel_size = surface->pixel_size;
+
+    fixed_t cos_a = fixed_cos(angle), sin_a = fixed_sin(angle);
+
+    /* Source steps per destination pixel, from the inverse rotation */
+    fixed_t du_dx = FIXED_DIV(cos_a, scale), dv_dx = FIXED_DIV(-sin_a, scale);
+    fixed_t du_dy = FIXED_DIV(sin_a, scale), dv_dy = FIXED_DIV(cos_a, scale);
+
+    /* Half extents of the rotated pixmap's bounding box */
+    int64_t abs_cos = (cos_a < 0 ? -cos_a : cos_a), abs_sin = (sin_a < 0 ? -sin_a : sin_a);
+    int32_t extent_x = (int32_t) (((width * abs_cos + height * abs_sin) * scale) >> (2 * FIXED_SHIFT + 1)) + 1;
+    int32_t extent_y = (int32_t) (((width * abs_sin + height * abs_cos) * scale) >> (2 * FIXED_SHIFT + 1)) + 1;
+
+    /* Clipping of the box is done once */
+    int32_t x0, y0, x1, y1;
+    if (!clip_rect(cx - extent_x, cy - extent_y, 2 * extent_x + 1, 2 * extent_y + 1, x_res, y_res, &x0, &y0, &x1, &y1))
+        return SPRITE_OK;
+
+    /* Source coordinates of the center of the first destination pixel */
+    fixed_t dx = INT_TO_FIXED(x0 - cx) + FIXED_HALF, dy = INT_TO_FIXED(y0 - cy) + FIXED_HALF;
+    fixed_t u_row = FIXED_MUL(dx, du_dx) + FIXED_MUL(dy, du_dy) + INT_TO_FIXED(width) / 2;
+    fixed_t v_row = FIXED_MUL(dx, dv_dx) + FIXED_MUL(dy, dv_dy) + INT_TO_FIXED(height) / 2;
+
+    const uint8_t *src = (const uint8_t *) pixmap;
+    for (int32_t row = y0; row < y1; row++, u_row += du_dy, v_row += dv_dy) {
+        /* Keep only the part of the row that maps inside the pixmap */
+        int32_t lo = 0, hi = x1 - x0;
+        clip_span(u_row, du_dx, INT_TO_FIXED(width), &lo, &hi);
+        clip_span(v_row, dv_dx, INT_TO_FIXED(height), &lo, &hi);
+
+        fixed_t u = u_row + lo * du_dx, v = v_row + lo * dv_dx;
+        uint8_t *dst = surface_at(surface, x0 + lo, row);
+
+        for (int32_t i = lo; i < hi; i++, u += du_dx, v += dv_dx, dst += pixel_size) {
+            const uint8_t *pixel = src + ((size_t) FIXED_TO_INT(v) * width + FIXED_TO_INT(u)) * pixel_size;
+            if (pixel_size == 1)
+                *dst = *pixel;
+            else
+                memcpy(dst, pixel, pixel_size);
+        }
+    }
+
+    vg_target_modified(surface->pixels);
+    return SPRITE_OK;
+}
@@ -0,0 +1,71 @@
+/*
+ * This file contains the scaled and rotated pixmap blitters
+ */
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <lcom/lcf.h>
+#include "vbe.h"
+#include "fixed.h"
+
+/**
+ * @brief Draws a pixmap resized to the given dimensions, sampling the nearest pixel
+ * 
+ * The pixmap holds pixels in the target's format (palette indices for indexed surfaces)
+ * 
+ * @param pixmap Pixmap to draw
+ * @param width Size in pixels of the pixmap along the x axis
+ * @param height Size in pixels of the pixmap along the y axis
+ * @param x Top left corner coordinate along the x axis, may be off the target
+ * @param y Top left corner coordinate along the y axis, may be off the target
+ * @param dst_width Size in pixels of the drawn pixmap along the x axis
+ * @param dst_height Size in pixels of the drawn pixmap along the y axis
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_pixmap_scaled_on(const char *pixmap, int width, int height, int16_t x, int16_t y, uint16_t dst_width, uint16_t dst_height, surface_t *surface);
+
+/**
+ * @brief Draws a true color image resized to the given dimensions with bilinear filtering
+ * 
+ * @param image Pixels to draw, 0x00RRGGBB
+ * @param width Size in pixels of the image along the x axis
+ * @param height Size in pixels of the image along the y axis
+ * @param x Top left corner coordinate along the x axis, may be off the target
+ * @param y Top left corner coordinate along the y axis, may be off the target
+ * @param dst_width Size in pixels of the drawn image along the x axis
+ * @param dst_height Size in pixels of the drawn image along the y axis
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_image_scaled_bilinear_on(const uint32_t *image, int width, int height, int16_t x, int16_t y, uint16_t dst_width, uint16_t dst_height, surface_t *surface);
+
+/**
+ * @brief Draws a pixmap rotated and scaled around its center, sampling the nearest pixel
+ * 
+ * @param pixmap Pixmap to draw, in the target's pixel format
+ * @param width Size in pixels of the pixmap along the x axis
+ * @param height Size in pixels of the pixmap along the y axis
+ * @param cx Coordinate along the x axis where the pixmap's center is drawn
+ * @param cy Coordinate along the y axis where the pixmap's center is drawn
+ * @param angle Clockwise rotation in 1/256 of a turn
+ * @param scale Scale factor in 16.16 fixed point, FIXED_ONE keeps the size
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_pixmap_rotated_on(const char *pixmap, int width, int height, int16_t cx, int16_t cy, uint8_t angle, fixed_t scale, surface_t *surface);
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease development and debugging
+ */
+typedef enum _sprite_status {
+    SPRITE_OK = OK,
+
+    /* invalid arguments on a function */
+    SPRITE_INVALID_ARGS,
+    /* the target's pixel format can not be drawn to */
+    SPRITE_INVALID_COLOR_MODE
+} sprite_status;
+
+#endif
@@ -0,0 +1,131 @@
+// IMPORTANT: you must include the following line in all your C files
+#include <lcom/lcf.h>
+#include "surface.h"
+#include "vbe.h"
+#include "util.h"
+
+/*
+ * Returns the size in bytes of a pixel in the given format, under the current mode
+ */
+static uint8_t format_pixel_size(buffer_format format) {
+    return (format == BUFFER_INDEXED ? 1 : calculate_size_in_bytes(get_bits_per_pixel()));
+}
+
+surface_t *surface_create(uint16_t width, uint16_t height, buffer_format format) {
+
+    if (width == 0 || height == 0) {
+        printf("(%s) Invalid dimensions: %dx%d\n", __func__, width, height);
+        return NULL;
+    }
+
+    uint8_t pixel_size = format_pixel_size(format);
+    size_t pitch = ((size_t) width * pixel_size + SURFACE_ROW_ALIGN - 1) & ~(size_t) (SURFACE_ROW_ALIGN - 1);
+
+    /* The descriptor and the pixels share one allocation, with room to align the first row */
+    surface_t *surface = malloc(sizeof(surface_t) + pitch * height + SURFACE_ROW_ALIGN - 1);
+    if (surface == NULL) {
+        printf("(%s) Couldnt allocate a %dx%d surface\n", __func__, width, height);
+        return NULL;
+    }
+
+    uintptr_t pixels = (uintptr_t) (surface + 1);
+    surface->pixels = (uint8_t *) ((pixels + SURFACE_ROW_ALIGN - 1) & ~(uintptr_t) (SURFACE_ROW_ALIGN - 1));
+    surface->width = width;
+    surface->height = height;
+    surface->pitch = pitch;
+    surface->format = format;
+    surface->pixel_size = pixel_size;
+    return surface;
+}
+
+void surface_destroy(surface_t *surface) {
+    free(surface);
+}
+
+void surface_wrap(surface_t *surface, uint8_t *pixels, uint16_t width, uint16_t height, buffer_format format) {
+    surface->width = width;
+    surface->height = height;
+    surface->format = format;
+    surface->pixel_size = format_pixel_size(format);
+    surface->pitch = (size_t) width * surface->pixel_size;
+    surface->pixels = pixels;
+}
+
+int surface_view(surface_t *view, const surface_t *parent, int16_t x, int16_t y, uint16_t width, uint16_t height) {
+
+    if (view == NULL || parent == NULL) {
+        printf("(%s) Invalid surface\n", __func__);
+        return SURFACE_INVALID_ARGS;
+    }
+
+    /* Clip the rectangle to the parent, an empty view is still valid */
+    int32_t x0 = (x < 0 ? 0 : x), y0 = (y < 0 ? 0 : y);
+    int32_t x1 = x + width, y1 = y + height;
+    if (x1 > parent->width) x1 = parent->width;
+    if (y1 > parent->height) y1 = parent->height;
+    if (x1 < x0) x1 = x0;
+    if (y1 < y0) y1 = y0;
+
+    *view = *parent;
+    view->width = x1 - x0;
+    view->height = y1 - y0;
+    view->pixels = (view->width && view->height ? surface_at(parent, x0, y0) : parent->pixels);
+    return SURFACE_OK;
+}
+
+void clear_surface(surface_t *surface, uint32_t color) {
+
+    /* Rows without padding are filled as one span */
+    if (surface->pitch == (size_t) surface->width * surface->pixel_size) {
+        fill_pixels(surface->pixels, color, (size_t) surface->width * surface->height, surface->pixel_size);
+    }
+    else {
+        for (uint16_t i = 0; i < surface->height; i++)
+            fill_pixels(surface_at(surface, 0, i), color, surface->width, surface->pixel_size);
+    }
+
+    vg_target_modified(surface->pixels);
+}
+
+int blit_surface(const surface_t *src, int16_t src_x, int16_t src_y, uint16_t width, uint16_t height, surface_t *dst, int16_t dst_x, int16_t dst_y) {
+
+    if (src == NULL || dst == NULL) {
+        printf("(%s) Invalid surface\n", __func__);
+        return SURFACE_INVALID_ARGS;
+    }
+
+    if (src->pixel_size != dst->pixel_size) {
+        printf("(%s) Surfaces have different pixel sizes\n", __func__);
+        return SURFACE_FORMAT_MISMATCH;
+    }
+
+    /* Clip the source so that both it and the destination are inside their surfaces */
+    int32_t dx = dst_x - src_x, dy = dst_y - src_y;
+    int32_t x0 = src_x, y0 = src_y, x1 = src_x + width, y1 = src_y + height;
+    if (x0 < 0) x0 = 0;
+    if (x0 < -dx) x0 = -dx;
+    if (y0 < 0) y0 = 0;
+    if (y0 < -dy) y0 = -dy;
+    if (x1 > src->width) x1 = src->width;
+    if (x1 > dst->width - dx) x1 = dst->width - dx;
+    if (y1 > src->height) y1 = src->height;
+    if (y1 > dst->height - dy) y1 = dst->height - dy;
+    if (x0 >= x1 || y0 >= y1)
+        return SURFACE_OK;
+
+    size_t row_bytes = (size_t) (x1 - x0) * src->pixel_size;
+    const uint8_t *from = surface_at(src, x0, y0);
+    uint8_t *to = surface_at(dst, x0 + dx, y0 + dy);
+
+    /* Whole rows of matching layouts are contiguous, so they copy as a single block */
+    if (row_bytes == src->pitch && row_bytes == dst->pitch) {
+        memcpy(to, from, row_bytes * (y1 - y0));
+    }
+    else {
+        for (int32_t i = y0; i < y1; i++, from += src->pitch, to += dst->pitch)
+            memcpy(to, from, row_bytes);
+    }
+
+    vg_target_modified(dst->pixels);
+    return SURFACE_OK;
+}
@@ -0,0 +1,102 @@
+/*
+ * This file contains the offscreen surfaces and the blits between surfaces.
+ * The surface_t type itself is in vbe.h, so every drawing module can take one as target.
+ */
+#ifndef SURFACE_H
+#define SURFACE_H
+
+#include <lcom/lcf.h>
+#include "vbe.h"
+
+/* Rows of created surfaces start on this boundary, so SSE2 stores stay aligned */
+#define SURFACE_ROW_ALIGN 16
+
+/**
+ * @brief Allocates an offscreen surface
+ * 
+ * Native surfaces take the pixel format of the current mode, so they
+ * must be created after vg_init and recreated after changing modes
+ * 
+ * @param width Size in pixels along the x axis
+ * @param height Size in pixels along the y axis
+ * @param format Pixel format of the surface
+ * @return Pointer to the new surface, NULL upon failure
+ */
+surface_t *surface_create(uint16_t width, uint16_t height, buffer_format format);
+
+/**
+ * @brief Frees a surface created with surface_create
+ * 
+ * @param surface Surface to free, may be NULL
+ */
+void surface_destroy(surface_t *surface);
+
+/**
+ * @brief Initializes a surface over pixels owned by the caller, such as a pixmap from read_xpm
+ * 
+ * Rows are taken to be contiguous
+ * 
+ * @param surface Address of memory to be initialized
+ * @param pixels First pixel of the top row
+ * @param width Size in pixels along the x axis
+ * @param height Size in pixels along the y axis
+ * @param format Pixel format of the pixels
+ */
+void surface_wrap(surface_t *surface, uint8_t *pixels, uint16_t width, uint16_t height, buffer_format format);
+
+/**
+ * @brief Initializes a surface that shares the pixels of a rectangle of another
+ * 
+ * Drawing to the view is clipped to the rectangle and shows on the parent.
+ * The view is only valid while the parent's pixels are.
+ * 
+ * @param view Address of memory to be initialized
+ * @param parent Surface to take the pixels from
+ * @param x Top left corner coordinate along the x axis, may be off the parent
+ * @param y Top left corner coordinate along the y axis, may be off the parent
+ * @param width Size in pixels along the x axis
+ * @param height Size in pixels along the y axis
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int surface_view(surface_t *view, const surface_t *parent, int16_t x, int16_t y, uint16_t width, uint16_t height);
+
+/**
+ * @brief Fills a whole surface with a color
+ * 
+ * @param surface Surface to clear
+ * @param color Color in the surface's pixel format
+ */
+void clear_surface(surface_t *surface, uint32_t color);
+
+/**
+ * @brief Copies a rectangle of a surface to another surface, clipped to both
+ * 
+ * Both surfaces must have the same pixel size. Source and destination
+ * must not overlap, move_region_on handles that within a surface.
+ * 
+ * @param src Surface to copy from
+ * @param src_x Source top left corner coordinate along the x axis
+ * @param src_y Source top left corner coordinate along the y axis
+ * @param width Size in pixels of the rectangle along the x axis
+ * @param height Size in pixels of the rectangle along the y axis
+ * @param dst Surface to copy to
+ * @param dst_x Destination top left corner coordinate along the x axis
+ * @param dst_y Destination top left corner coordinate along the y axis
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int blit_surface(const surface_t *src, int16_t src_x, int16_t src_y, uint16_t width, uint16_t height, surface_t *dst, int16_t dst_x, int16_t dst_y);
+
+/*
+ * Enumeration that contains possible error codes
+ * for the functions to ease debugging.
+ */
+typedef enum _surface_status {
+    /* operation was successful */
+    SURFACE_OK = OK,
+    /* invalid arguments */
+    SURFACE_INVALID_ARGS,
+    /* surfaces with different pixel sizes */
+    SURFACE_FORMAT_MISMATCH
+} surface_status;
+
+#endif /* end of include guard: SURFACE_H */
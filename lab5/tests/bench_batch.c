@@ -0,0 +1,45 @@
+/*
+ * Host benchmark of sprite_batch_draw: 10000 sprites with random depths
+ * scattered around a 100x80 surface, most of them culled, timed over 100 frames.
+ */
+#include <lcom/lcf.h>
+#include <time.h>
+#include "batch.h"
+#include "anim.h"
+#include "surface.h"
+
+#define SPRITES 10000
+#define FRAMES 100
+
+int main() {
+
+    /* Four fully opaque 2x4 frames side by side */
+    static uint8_t pixels[8 * 4];
+    for (uint32_t i = 0; i < sizeof(pixels); i++)
+        pixels[i] = 1 + i % 7;
+
+    surface_t sheet_pixels;
+    surface_wrap(&sheet_pixels, pixels, 8, 4, BUFFER_INDEXED);
+    sprite_sheet sheet;
+    surface_t *target = surface_create(100, 80, BUFFER_INDEXED);
+    sprite_batch batch;
+    if (target == NULL || sprite_sheet_init(&sheet, &sheet_pixels, 0) != ANIM_OK ||
+        sprite_sheet_add_grid(&sheet, 2, 4, 1, 2, 1) != ANIM_OK || sprite_batch_init(&batch) != BATCH_OK)
+        return 1;
+
+    srand(1);
+    for (uint32_t i = 0; i < SPRITES; i++)
+        sprite_batch_add(&batch, &sheet, i % 4, rand() % 200 - 50, rand() % 160 - 40, rand());
+
+    clock_t start = clock();
+    for (uint32_t frame = 0; frame < FRAMES; frame++)
+        sprite_batch_draw(&batch, target);
+    double ms = (double) (clock() - start) * 1000 / CLOCKS_PER_SEC / FRAMES;
+
+    printf("sprite_batch_draw: %d sprites, %u drawn, %u culled, %.3f ms per frame\n", SPRITES, batch.drawn, batch.culled, ms);
+
+    sprite_batch_free(&batch);
+    sprite_sheet_free(&sheet);
+    surface_destroy(target);
+    return 0;
+}
@@ -0,0 +1,41 @@
+/*
+ * Host benchmark of motion_update: 10000 sprites looping along a shared
+ * four keyframe path, with staggered starts, timed over 1000 ticks.
+ */
+#include <lcom/lcf.h>
+#include <time.h>
+#include "motion.h"
+#include "fixed.h"
+
+#define SPRITES 10000
+#define TICKS 1000
+
+int main() {
+
+    motion_key keys[] = {
+        {0, INT_TO_FIXED(0), INT_TO_FIXED(0), EASE_LINEAR},
+        {10, INT_TO_FIXED(100), INT_TO_FIXED(50), EASE_IN_OUT},
+        {30, INT_TO_FIXED(100), INT_TO_FIXED(150), EASE_STEP},
+        {40, INT_TO_FIXED(0), INT_TO_FIXED(0), EASE_LINEAR}
+    };
+
+    motion_path path;
+    motion_set set;
+    if (motion_path_init(&path, keys, sizeof(keys) / sizeof(keys[0])) != MOTION_OK || motion_set_init(&set) != MOTION_OK)
+        return 1;
+
+    for (uint32_t i = 0; i < SPRITES; i++)
+        if (motion_add(&set, &path, i % 40, MOTION_LOOP) < 0)
+            return 1;
+
+    clock_t start = clock();
+    for (uint32_t now = 0; now < TICKS; now++)
+        motion_update(&set, now);
+    double ms = (double) (clock() - start) * 1000 / CLOCKS_PER_SEC / TICKS;
+
+    printf("motion_update: %d sprites, %.3f ms per tick\n", SPRITES, ms);
+
+    motion_set_free(&set);
+    motion_path_free(&path);
+    return 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * This file stands in for the lcf header when building the tests on the host.
+ * It only declares what the headers of the modules under test need.
+ */
+#ifndef LCF_HOST_H
+#define LCF_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OK 0
+
+#ifndef BIT
+#define BIT(n) (0x01<<(n))
+#endif
+
+/* Only used through pointers by the module headers */
+typedef struct vbe_mode_info vbe_mode_info_t;
+typedef struct mmap mmap_t;
+
+/* Mouse packet, as filled in by parse_mouse_packet */
+struct packet {
+    uint8_t bytes[3];
+    bool rb, mb, lb;
+    int16_t delta_x, delta_y;
+    bool x_ov, y_ov;
+};
+
+#endif /* end of include guard: LCF_HOST_H */
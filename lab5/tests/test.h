@@ -0,0 +1,23 @@
+/*
+ * This file contains the checks shared by the host tests
+ */
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+/* Number of failed checks of the current test program */
+static int test_failures = 0;
+
+/* Reports a failed condition without stopping the test */
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+/* Exit status of a test program */
+#define TEST_RESULT() (printf("%s: %s\n", __FILE__, test_failures ? "FAILED" : "passed"), test_failures != 0)
+
+#endif /* end of include guard: TEST_H */
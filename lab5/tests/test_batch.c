@@ -0,0 +1,138 @@
+/*
+ * Host tests of the sprite batch's culling and depth sort.
+ * The sheet functions are replaced by doubles that log the draw order.
+ */
+#include <lcom/lcf.h>
+#include "batch.h"
+#include "anim.h"
+#include "test.h"
+
+#define SURFACE_SIZE 100
+#define MAX_SPRITES (SURFACE_SIZE * SURFACE_SIZE)
+
+/* Every sprite is queued at a distinct position, so its position identifies it */
+#define SPRITE_ID(x, y) ((y) * SURFACE_SIZE + (x))
+
+static uint32_t drawn_ids[MAX_SPRITES];
+static uint32_t drawn_count = 0;
+
+/* Frame 0 covers the pixel at the pivot, frame 1 is fully transparent */
+void sprite_frame_bounds(const sprite_sheet *sheet, uint16_t frame, int16_t x, int16_t y, sprite_rect *rect) {
+    (void) sheet;
+    rect->x = x;
+    rect->y = y;
+    rect->width = rect->height = (frame == 0 ? 1 : 0);
+}
+
+int draw_sprite_frame_on(const sprite_sheet *sheet, uint16_t frame, int16_t x, int16_t y, surface_t *surface) {
+    (void) sheet; (void) frame; (void) surface;
+    drawn_ids[drawn_count++] = SPRITE_ID(x, y);
+    return OK;
+}
+
+static sprite_sheet sheet = { .frame_count = 2 };
+static surface_t surface = { .width = SURFACE_SIZE, .height = SURFACE_SIZE };
+
+static uint16_t depths[MAX_SPRITES];
+
+/*
+ * Queues count on surface sprites with the given depths and checks they are drawn in stable depth order
+ */
+static void check_sorted(sprite_batch *batch, uint32_t count) {
+
+    sprite_batch_begin(batch);
+    for (uint32_t i = 0; i < count; i++)
+        CHECK(sprite_batch_add(batch, &sheet, 0, i % SURFACE_SIZE, i / SURFACE_SIZE, depths[i]) == BATCH_OK);
+
+    drawn_count = 0;
+    CHECK(sprite_batch_draw(batch, &surface) == BATCH_OK);
+    CHECK(drawn_count == count);
+    CHECK(batch->drawn == count && batch->culled == 0);
+
+    /* Sprites are queued in id order, so equal depths must keep increasing ids */
+    for (uint32_t i = 1; i < drawn_count; i++) {
+        uint16_t prev = depths[drawn_ids[i - 1]], cur = depths[drawn_ids[i]];
+        CHECK(prev < cur || (prev == cur && drawn_ids[i - 1] < drawn_ids[i]));
+    }
+}
+
+static void test_equal_depths(sprite_batch *batch) {
+    /* Both passes are skipped */
+    for (uint32_t i = 0; i < 500; i++)
+        depths[i] = 7;
+    check_sorted(batch, 500);
+}
+
+static void test_low_byte_only(sprite_batch *batch) {
+    /* The high byte pass is skipped */
+    for (uint32_t i = 0; i < 500; i++)
+        depths[i] = 0x4200 | (rand() % 16);
+    check_sorted(batch, 500);
+}
+
+static void test_high_byte_only(sprite_batch *batch) {
+    /* The low byte pass is skipped, the high one must still be stable */
+    for (uint32_t i = 0; i < 500; i++)
+        depths[i] = ((rand() % 16) << 8) | 0x33;
+    check_sorted(batch, 500);
+}
+
+static void test_random_depths(sprite_batch *batch) {
+    /* More sprites than BATCH_INITIAL, so the batch grows */
+    for (uint32_t i = 0; i < MAX_SPRITES; i++)
+        depths[i] = rand() % 65536;
+    check_sorted(batch, MAX_SPRITES);
+    CHECK(batch->capacity >= MAX_SPRITES);
+}
+
+static void test_culling(sprite_batch *batch) {
+
+    sprite_batch_begin(batch);
+    sprite_batch_add(batch, &sheet, 0, 10, 10, 1);
+    sprite_batch_add(batch, &sheet, 0, -1, 10, 0);            /* Left of the surface */
+    sprite_batch_add(batch, &sheet, 0, 10, SURFACE_SIZE, 0);  /* Below the surface */
+    sprite_batch_add(batch, &sheet, 1, 20, 20, 0);            /* Nothing opaque */
+    sprite_batch_add(batch, &sheet, 0, 5, 5, 0);
+    CHECK(sprite_batch_add(batch, &sheet, 2, 5, 5, 0) != BATCH_OK); /* No such frame */
+
+    drawn_count = 0;
+    CHECK(sprite_batch_draw(batch, &surface) == BATCH_OK);
+    CHECK(batch->drawn == 2 && batch->culled == 3);
+    CHECK(drawn_count == 2);
+    CHECK(drawn_ids[0] == SPRITE_ID(5, 5) && drawn_ids[1] == SPRITE_ID(10, 10));
+}
+
+static void test_format_mismatch(sprite_batch *batch) {
+
+    /* Sprites of a sheet with another pixel size are reported, the others still drawn */
+    sprite_sheet wide = { .frame_count = 1 };
+    wide.pixels.pixel_size = 4;
+
+    sprite_batch_begin(batch);
+    sprite_batch_add(batch, &sheet, 0, 1, 1, 0);
+    sprite_batch_add(batch, &wide, 0, 2, 2, 0);
+    sprite_batch_add(batch, &sheet, 0, -5, 3, 0);
+
+    drawn_count = 0;
+    CHECK(sprite_batch_draw(batch, &surface) == BATCH_FORMAT_MISMATCH);
+    CHECK(batch->drawn == 1 && batch->culled == 1);
+    CHECK(drawn_count == 1 && drawn_ids[0] == SPRITE_ID(1, 1));
+}
+
+int main() {
+
+    srand(1);
+    sprite_batch batch;
+    if (sprite_batch_init(&batch) != BATCH_OK)
+        return 1;
+
+    test_equal_depths(&batch);
+    test_low_byte_only(&batch);
+    test_high_byte_only(&batch);
+    test_random_depths(&batch);
+    test_culling(&batch);
+    test_format_mismatch(&batch);
+
+    sprite_batch_free(&batch);
+    return TEST_RESULT();
+}
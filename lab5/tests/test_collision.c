@@ -0,0 +1,188 @@
+/*
+ * Host tests of the collision masks and of the grid broadphase,
+ * checked against a pixel by pixel reference.
+ */
+#include <lcom/lcf.h>
+#include "collision.h"
+#include "surface.h"
+#include "vbe.h"
+#include "test.h"
+
+#define IMAGE_MAX 140
+#define IMAGE_COUNT 6
+
+/* Test images, 0 is transparent */
+typedef struct {
+    uint16_t width, height;
+    uint8_t pixels[IMAGE_MAX * IMAGE_MAX];
+    collision_mask mask;
+} image;
+
+static image images[IMAGE_COUNT];
+
+static void image_init(image *img, uint16_t width, uint16_t height, uint8_t density) {
+    img->width = width;
+    img->height = height;
+    for (uint32_t i = 0; i < (uint32_t) width * height; i++)
+        img->pixels[i] = (rand() % 100 < density ? 1 + rand() % 255 : 0);
+
+    surface_t s;
+    surface_wrap(&s, img->pixels, width, height, BUFFER_INDEXED);
+    CHECK(collision_mask_init(&img->mask, &s, 0) == COLLISION_OK);
+}
+
+static bool opaque(const image *img, int32_t x, int32_t y) {
+    return x >= 0 && y >= 0 && x < img->width && y < img->height && img->pixels[y * img->width + x] != 0;
+}
+
+/* Reference test, one pixel at a time */
+static bool collide_slow(const image *a, int32_t ax, int32_t ay, const image *b, int32_t bx, int32_t by) {
+    for (int32_t y = 0; y < a->height; y++)
+        for (int32_t x = 0; x < a->width; x++)
+            if (opaque(a, x, y) && opaque(b, x + ax - bx, y + ay - by))
+                return true;
+    return false;
+}
+
+static bool collide(const image *a, int16_t ax, int16_t ay, const image *b, int16_t bx, int16_t by) {
+    collision_object oa = {&a->mask, ax, ay}, ob = {&b->mask, bx, by};
+    bool hit = collision_test(&oa, &ob);
+    CHECK(hit == collision_test(&ob, &oa));
+    return hit;
+}
+
+static void test_word_boundaries() {
+
+    /* A 128 pixel wide row whose only opaque pixels are the last of each word */
+    image *wide = &images[0];
+    wide->width = 128;
+    wide->height = 1;
+    memset(wide->pixels, 0, sizeof(wide->pixels));
+    wide->pixels[63] = wide->pixels[127] = 1;
+    surface_t s;
+    surface_wrap(&s, wide->pixels, 128, 1, BUFFER_INDEXED);
+    CHECK(collision_mask_init(&wide->mask, &s, 0) == COLLISION_OK);
+    CHECK(wide->mask.words_per_row == 2);
+
+    image *dot = &images[1];
+    dot->width = dot->height = 1;
+    dot->pixels[0] = 1;
+    surface_wrap(&s, dot->pixels, 1, 1, BUFFER_INDEXED);
+    CHECK(collision_mask_init(&dot->mask, &s, 0) == COLLISION_OK);
+
+    /* Shift 0, and shift 63 in the first and second word */
+    CHECK(!collide(wide, 0, 0, dot, 0, 0));
+    CHECK(collide(wide, 0, 0, dot, 63, 0));
+    CHECK(!collide(wide, 0, 0, dot, 62, 0));
+    CHECK(!collide(wide, 0, 0, dot, 64, 0));
+    CHECK(collide(wide, 0, 0, dot, 127, 0));
+    CHECK(!collide(wide, 0, 0, dot, 128, 0));
+
+    /* Two wide rows: the pixels of one land on the other only at some offsets */
+    CHECK(collide(wide, 0, 0, wide, 64, 0));
+    CHECK(!collide(wide, 0, 0, wide, 1, 0));
+    CHECK(!collide(wide, 0, 0, wide, 63, 0));
+    CHECK(collide(wide, 0, 0, wide, 0, 0));
+    CHECK(!collide(wide, 0, 0, wide, 0, 1));
+
+    collision_mask_free(&wide->mask);
+    collision_mask_free(&dot->mask);
+}
+
+static void test_random_masks() {
+
+    /* Widths around the word size, so every shift and word count is reached */
+    static const uint16_t widths[IMAGE_COUNT] = {1, 63, 64, 65, 129, 140};
+    for (uint8_t i = 0; i < IMAGE_COUNT; i++)
+        image_init(&images[i], widths[i], 1 + rand() % 20, 3);
+
+    for (uint8_t a = 0; a < IMAGE_COUNT; a++)
+        for (uint8_t b = 0; b < IMAGE_COUNT; b++)
+            for (int16_t dx = -IMAGE_MAX - 1; dx <= IMAGE_MAX + 1; dx++) {
+                int16_t dy = rand() % 40 - 20;
+                CHECK(collide(&images[a], 10, 10, &images[b], 10 + dx, 10 + dy) ==
+                      collide_slow(&images[a], 10, 10, &images[b], 10 + dx, 10 + dy));
+            }
+}
+
+static void test_mask_from_frame() {
+
+    /* A 4x3 frame whose only opaque pixels are (1, 1) and (2, 1) */
+    static uint8_t pixels[12] = {0, 0, 0, 0,
+                                 0, 5, 6, 0,
+                                 0, 0, 0, 0};
+    sprite_frame frame = {.source = {0, 0, 4, 3}, .pivot_x = 2, .pivot_y = 2, .ticks = 1, .opaque = {1, 1, 2, 1}};
+    sprite_sheet sheet = {.colorkey = 0, .frames = &frame, .frame_count = 1, .frame_capacity = 1};
+    surface_wrap(&sheet.pixels, pixels, 4, 3, BUFFER_INDEXED);
+
+    collision_mask mask;
+    CHECK(collision_mask_from_frame(&mask, &sheet, 0) == COLLISION_OK);
+    CHECK(mask.width == 2 && mask.height == 1);
+    CHECK(mask.origin_x == -1 && mask.origin_y == -1);
+    CHECK(mask.bits[0] == 3);
+    CHECK(collision_mask_from_frame(&mask, &sheet, 1) != COLLISION_OK);
+    collision_mask_free(&mask);
+}
+
+#define GRID_OBJECTS 400
+
+static void test_grid_pairs() {
+
+    for (uint8_t i = 0; i < IMAGE_COUNT; i++)
+        image_init(&images[i], 1 + rand() % 100, 1 + rand() % 100, 20);
+
+    collision_grid grid;
+    CHECK(collision_grid_init(&grid, 320, 200, 16) == COLLISION_OK);
+
+    /* Two objects spanning many cells are reported once */
+    collision_object pair[2] = {{&images[0].mask, 0, 0}, {&images[0].mask, 0, 0}};
+    CHECK(collision_find_pairs(&grid, pair, 2) == COLLISION_OK);
+    CHECK(grid.pair_count == 1 && grid.pairs[0].a == 0 && grid.pairs[0].b == 1);
+
+    /* Random scenes, some objects partly off the grid */
+    static collision_object objects[GRID_OBJECTS];
+    static uint8_t kind[GRID_OBJECTS];
+    static uint8_t found[GRID_OBJECTS][GRID_OBJECTS];
+
+    for (int scene = 0; scene < 10; scene++) {
+        for (uint32_t i = 0; i < GRID_OBJECTS; i++) {
+            kind[i] = rand() % IMAGE_COUNT;
+            objects[i] = (collision_object) {&images[kind[i]].mask, rand() % 300 - 50, rand() % 220 - 50};
+        }
+        CHECK(collision_find_pairs(&grid, objects, GRID_OBJECTS) == COLLISION_OK);
+
+        memset(found, 0, sizeof(found));
+        for (uint32_t p = 0; p < grid.pair_count; p++) {
+            CHECK(grid.pairs[p].a < grid.pairs[p].b && grid.pairs[p].b < GRID_OBJECTS);
+            CHECK(found[grid.pairs[p].a][grid.pairs[p].b]++ == 0);
+        }
+
+        /* Every colliding pair that overlaps inside the grid is found */
+        uint32_t expected = 0;
+        for (uint32_t i = 0; i < GRID_OBJECTS; i++)
+            for (uint32_t j = i + 1; j < GRID_OBJECTS; j++) {
+                const image *a = &images[kind[i]], *b = &images[kind[j]];
+                int32_t x1 = (objects[i].x + a->width < objects[j].x + b->width ? objects[i].x + a->width : objects[j].x + b->width);
+                int32_t y1 = (objects[i].y + a->height < objects[j].y + b->height ? objects[i].y + a->height : objects[j].y + b->height);
+                if (x1 <= 0 || y1 <= 0 || !collide_slow(a, objects[i].x, objects[i].y, b, objects[j].x, objects[j].y))
+                    continue;
+                expected++;
+                CHECK(found[i][j] == 1);
+            }
+        CHECK(grid.pair_count == expected);
+    }
+
+    collision_grid_free(&grid);
+    for (uint8_t i = 0; i < IMAGE_COUNT; i++)
+        collision_mask_free(&images[i].mask);
+}
+
+int main() {
+
+    srand(1);
+    test_word_boundaries();
+    test_random_masks();
+    test_mask_from_frame();
+    test_grid_pairs();
+    return TEST_RESULT();
+}
@@ -0,0 +1,254 @@
+/*
+ * Host tests of the hit testing grid, checked against a linear scan
+ */
+#include <lcom/lcf.h>
+#include "hitgrid.h"
+#include "test.h"
+
+#define GRID_WIDTH 320
+#define GRID_HEIGHT 200
+#define CELL_SIZE 16
+#define MAX_OBJECTS 2000
+
+/* Reference copy of the objects */
+static sprite_rect bounds[MAX_OBJECTS];
+static uint16_t depths[MAX_OBJECTS];
+static uint32_t count = 0;
+
+static bool contains(const sprite_rect *r, int16_t x, int16_t y) {
+    return x >= r->x && y >= r->y && x < r->x + r->width && y < r->y + r->height;
+}
+
+static bool intersects(const sprite_rect *a, const sprite_rect *b) {
+    return a->width && a->height && b->width && b->height &&
+           a->x < b->x + b->width && b->x < a->x + a->width && a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+/*
+ * Checks every cell only lists existing objects, and every object is listed once in exactly its cells
+ */
+static void check_cells(const hit_grid *grid) {
+    for (uint16_t r = 0; r < grid->rows; r++) {
+        for (uint16_t c = 0; c < grid->cols; c++) {
+            const hit_cell *cell = &grid->cells[r * grid->cols + c];
+            for (uint32_t i = 0; i < cell->count; i++) {
+                uint32_t id = cell->ids[i];
+                CHECK(id < grid->count);
+                if (id >= grid->count)
+                    continue;
+
+                const hit_object *o = &grid->objects[id];
+                CHECK(o->listed && c >= o->c0 && c <= o->c1 && r >= o->r0 && r <= o->r1);
+                for (uint32_t j = i + 1; j < cell->count; j++)
+                    CHECK(cell->ids[j] != id);
+            }
+        }
+    }
+
+    uint64_t listed = 0, references = 0;
+    for (uint32_t i = 0; i < grid->count; i++)
+        if (grid->objects[i].listed)
+            listed += (uint64_t) (grid->objects[i].c1 - grid->objects[i].c0 + 1) * (grid->objects[i].r1 - grid->objects[i].r0 + 1);
+    for (uint32_t c = 0; c < (uint32_t) grid->cols * grid->rows; c++)
+        references += grid->cells[c].count;
+    CHECK(listed == references);
+}
+
+static void check_point(const hit_grid *grid, int16_t x, int16_t y) {
+    int best = HIT_NONE;
+    if (x >= 0 && y >= 0 && x < GRID_WIDTH && y < GRID_HEIGHT)
+        for (uint32_t i = 0; i < count; i++)
+            if (contains(&bounds[i], x, y) && (best == HIT_NONE || depths[i] > depths[best]))
+                best = i;
+
+    int hit = hit_grid_at(grid, x, y);
+    CHECK((hit == HIT_NONE) == (best == HIT_NONE));
+    if (hit != HIT_NONE && best != HIT_NONE)
+        CHECK(contains(&bounds[hit], x, y) && depths[hit] == depths[best]);
+}
+
+static void check_query(const hit_grid *grid, const sprite_rect *area) {
+    static uint32_t found[MAX_OBJECTS];
+    static uint8_t seen[MAX_OBJECTS];
+    uint32_t n = hit_grid_query(grid, area, found, MAX_OBJECTS);
+
+    memset(seen, 0, sizeof(seen));
+    for (uint32_t i = 0; i < n; i++) {
+        CHECK(found[i] < count);
+        if (found[i] < count)
+            CHECK(seen[found[i]]++ == 0);
+    }
+
+    /* Only the parts inside the grid are searched */
+    sprite_rect inside = {0, 0, GRID_WIDTH, GRID_HEIGHT};
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sprite_rect overlap = bounds[i];
+        bool hit = intersects(&bounds[i], area);
+        if (hit) {
+            int16_t x0 = (bounds[i].x > area->x ? bounds[i].x : area->x), y0 = (bounds[i].y > area->y ? bounds[i].y : area->y);
+            int16_t x1 = (bounds[i].x + bounds[i].width < area->x + area->width ? bounds[i].x + bounds[i].width : area->x + area->width);
+            int16_t y1 = (bounds[i].y + bounds[i].height < area->y + area->height ? bounds[i].y + bounds[i].height : area->y + area->height);
+            overlap = (sprite_rect) {x0, y0, x1 - x0, y1 - y0};
+            hit = intersects(&overlap, &inside);
+        }
+        if (hit) {
+            expected++;
+            CHECK(seen[i] == 1);
+        }
+    }
+    CHECK(n == expected);
+}
+
+static void reference_remove(uint32_t index) {
+    count--;
+    bounds[index] = bounds[count];
+    depths[index] = depths[count];
+}
+
+static void test_swap_remove(hit_grid *grid) {
+
+    /* Three overlapping objects sharing cells */
+    sprite_rect a = {10, 10, 40, 40}, b = {20, 20, 40, 40}, c = {30, 30, 40, 40};
+    CHECK(hit_grid_add(grid, &a, 1) == 0);
+    CHECK(hit_grid_add(grid, &b, 2) == 1);
+    CHECK(hit_grid_add(grid, &c, 3) == 2);
+    bounds[0] = a; bounds[1] = b; bounds[2] = c;
+    depths[0] = 1; depths[1] = 2; depths[2] = 3;
+    count = 3;
+
+    /* The last object takes the removed index in every cell */
+    hit_grid_remove(grid, 0);
+    reference_remove(0);
+    CHECK(grid->count == 2);
+    check_cells(grid);
+    CHECK(hit_grid_at(grid, 65, 65) == 0);
+    CHECK(hit_grid_at(grid, 25, 25) == 1);
+    CHECK(hit_grid_at(grid, 12, 12) == HIT_NONE);
+
+    /* Removing the last object needs no renumbering */
+    hit_grid_remove(grid, 1);
+    reference_remove(1);
+    check_cells(grid);
+    CHECK(hit_grid_at(grid, 25, 25) == HIT_NONE);
+    CHECK(hit_grid_at(grid, 35, 35) == 0);
+
+    hit_grid_remove(grid, 0);
+    reference_remove(0);
+    check_cells(grid);
+}
+
+static void test_marquee(hit_grid *grid) {
+
+    /* An object and a marquee both spanning many cells */
+    sprite_rect big = {-20, -20, 200, 150};
+    CHECK(hit_grid_add(grid, &big, 0) == 0);
+    bounds[0] = big;
+    depths[0] = 0;
+    count = 1;
+
+    sprite_rect area = {5, 5, 300, 300};
+    uint32_t found[4];
+    CHECK(hit_grid_query(grid, &area, found, 4) == 1 && found[0] == 0);
+    check_query(grid, &area);
+
+    hit_grid_remove(grid, 0);
+    reference_remove(0);
+}
+
+static void test_moves(hit_grid *grid) {
+
+    sprite_rect r = {100, 100, 8, 8};
+    CHECK(hit_grid_add(grid, &r, 0) == 0);
+
+    /* Within the same cells, to other cells, off the grid and back */
+    sprite_rect moves[] = {{101, 101, 8, 8}, {150, 40, 20, 20}, {-40, -40, 8, 8}, {400, 10, 8, 8}, {310, 190, 30, 30}};
+    for (uint32_t i = 0; i < sizeof(moves) / sizeof(moves[0]); i++) {
+        CHECK(hit_grid_move(grid, 0, &moves[i]) == HIT_OK);
+        check_cells(grid);
+        bool on_grid = moves[i].x < GRID_WIDTH && moves[i].x + moves[i].width > 0;
+        CHECK(grid->objects[0].listed == on_grid);
+
+        int16_t x = moves[i].x + moves[i].width / 2, y = moves[i].y + moves[i].height / 2;
+        if (x >= 0 && y >= 0 && x < GRID_WIDTH && y < GRID_HEIGHT)
+            CHECK(hit_grid_at(grid, x, y) == 0);
+    }
+    CHECK(hit_grid_move(grid, 1, &r) != HIT_OK);
+
+    hit_grid_remove(grid, 0);
+}
+
+static sprite_rect random_rect() {
+    return (sprite_rect) {rand() % 380 - 30, rand() % 260 - 30, rand() % 50, rand() % 50};
+}
+
+static void test_random_operations(hit_grid *grid) {
+
+    for (uint32_t step = 0; step < 50000; step++) {
+        int op = rand() % 10;
+
+        if ((op < 3 || count == 0) && count < MAX_OBJECTS) {
+            bounds[count] = random_rect();
+            depths[count] = rand() % 50;
+            CHECK(hit_grid_add(grid, &bounds[count], depths[count]) == (int) count);
+            count++;
+        }
+        else if (op < 4) {
+            uint32_t i = rand() % count;
+            hit_grid_remove(grid, i);
+            reference_remove(i);
+        }
+        else if (op < 8) {
+            uint32_t i = rand() % count;
+            if (rand() % 2) {
+                bounds[i].x += rand() % 5 - 2;
+                bounds[i].y += rand() % 5 - 2;
+            }
+            else
+                bounds[i] = random_rect();
+            CHECK(hit_grid_move(grid, i, &bounds[i]) == HIT_OK);
+        }
+        else if (op < 9)
+            check_point(grid, rand() % 380 - 30, rand() % 260 - 30);
+        else {
+            sprite_rect area = random_rect();
+            area.width *= 3;
+            area.height *= 3;
+            check_query(grid, &area);
+        }
+
+        if (step % 5000 == 0)
+            check_cells(grid);
+    }
+    check_cells(grid);
+}
+
+static void test_cursor(const hit_grid *grid) {
+
+    /* The mouse's y axis points up, the screen's down */
+    int16_t x = 10, y = 10;
+    struct packet pp = {.delta_x = 5, .delta_y = 3};
+    hit_cursor_move(grid, &x, &y, &pp);
+    CHECK(x == 15 && y == 7);
+
+    pp = (struct packet) {.delta_x = -100, .delta_y = -500};
+    hit_cursor_move(grid, &x, &y, &pp);
+    CHECK(x == 0 && y == GRID_HEIGHT - 1);
+}
+
+int main() {
+
+    srand(1);
+    hit_grid grid;
+    if (hit_grid_init(&grid, GRID_WIDTH, GRID_HEIGHT, CELL_SIZE) != HIT_OK)
+        return 1;
+
+    test_swap_remove(&grid);
+    test_marquee(&grid);
+    test_moves(&grid);
+    test_random_operations(&grid);
+    test_cursor(&grid);
+
+    hit_grid_free(&grid);
+    return TEST_RESULT();
+}
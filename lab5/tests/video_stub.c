@@ -0,0 +1,18 @@
+/*
+ * This file replaces the video card functions the surfaces and sheets need,
+ * as an 8 bits per pixel mode in memory.
+ */
+#include <lcom/lcf.h>
+#include "vbe.h"
+
+uint8_t get_bits_per_pixel() {
+    return 8;
+}
+
+void fill_pixels(uint8_t *dst, uint32_t color, size_t count, uint8_t pixel_size) {
+    memset(dst, color, count * pixel_size);
+}
+
+void vg_target_modified(const uint8_t *buffer) {
+    (void) buffer;
+}
@@ -15,3 +15,26 @@ uint32_t set_bits_mask(uint8_t n) {
 uint8_t calculate_size_in_bytes(uint8_t bits) {
 	return (uint8_t)(bits / BYTE_SIZE) +  (bits % BYTE_SIZE ? 1 : 0);
 }
+
+uint64_t read_tsc() {
+	uint32_t low, high;
+	__asm__ __volatile__("rdtsc" : "=a" (low), "=d" (high));
+	return ((uint64_t) high << 32) | low;
+}
+
+bool grow_arrays(void **arrays[], const size_t *element_sizes, uint8_t count, uint32_t capacity) {
+	bool grown = true;
+	for (uint8_t i = 0; i < count; i++) {
+		/* Arrays that did grow are harmless, the caller only changes its capacity once all of them have */
+		if (element_sizes[i] != 0 && capacity > SIZE_MAX / element_sizes[i]) {
+			grown = false;
+			continue;
+		}
+		void *array = realloc(*arrays[i], capacity * element_sizes[i]);
+		if (array != NULL)
+			*arrays[i] = array;
+		else
+			grown = false;
+	}
+	return grown;
+}
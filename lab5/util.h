@@ -22,4 +22,24 @@ uint32_t set_bits_mask(uint8_t n);
  */
 uint8_t calculate_size_in_bytes(uint8_t bits);
 
+/**
+ * @brief Reads the processor's time stamp counter
+ * 
+ * @return Returns the number of cycles since reset
+ */
+uint64_t read_tsc();
+
+/**
+ * @brief Reallocates parallel arrays to the same number of elements
+ * 
+ * Arrays that could grow keep their new size even when another one could not
+ * 
+ * @param arrays Addresses of the pointers to each array
+ * @param element_sizes Size in bytes of the elements of each array
+ * @param count Number of arrays
+ * @param capacity New number of elements
+ * @return Returns true if every array was reallocated, false if any failed or its size overflows size_t
+ */
+bool grow_arrays(void **arrays[], const size_t *element_sizes, uint8_t count, uint32_t capacity);
+
 #endif
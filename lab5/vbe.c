@@ -3,9 +3,76 @@
 #include <math.h>
 #include <stdlib.h>
 #include "util.h"
+#include "palette.h"
+#include "blend.h"
+#include "surface.h"
+#include "fill.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 static vbe_mode_info_t vbe_mode_info;
 static uint8_t* mapped_mem;
+static surface_t screen_surface; /* The mapped VRAM, spanning the virtual canvas */
+
+/* Copy of the last presented frame, used to skip unchanged blocks */
+static uint8_t* shadow_mem = NULL;
+static bool shadow_valid = false;
+static bool present_compare = true;
+
+/* Copies a frame region from a back buffer to VRAM */
+typedef void (*present_copy_t)(uint8_t *dst, const uint8_t *src, size_t size);
+
+static void copy_memcpy(uint8_t *dst, const uint8_t *src, size_t size);
+static void copy_rep_movsd(uint8_t *dst, const uint8_t *src, size_t size);
+static void copy_stream(uint8_t *dst, const uint8_t *src, size_t size);
+static void copy_rows(uint8_t *dst, const uint8_t *src, size_t size);
+
+/* Indexed by present_copy_strategy */
+static const present_copy_t present_copies[PRESENT_COPY_COUNT] = {
+    copy_memcpy, copy_rep_movsd, copy_stream, copy_rows
+};
+
+static present_copy_strategy present_strategy = PRESENT_COPY_MEMCPY;
+
+/* Retrace synchronization and where the time of each present goes */
+static present_sync present_sync_mode = PRESENT_SYNC_NONE;
+
+/* Refresh rate asked for in vg_init, and the one in use, in 0.01 Hz (0 if unknown) */
+static uint16_t requested_refresh = 0;
+static uint32_t refresh_rate = 0;
+static uint16_t vbe_version = 0;
+
+/* Virtual address of physical address 0, where lm_init maps the first megabyte */
+static uint8_t *lm_base = NULL;
+
+/* Copy of the VBE protected mode interface, and its entry points (NULL when unavailable) */
+static uint16_t *pm_table = NULL;
+static void *pm_set_display_start = NULL;
+static void *pm_set_palette = NULL;
+
+/* Palette entries in the DAC format the BIOS expects: blue, green, red, padding */
+static uint8_t dac_entries[PALETTE_SIZE * 4];
+static present_stats stats;
+static uint32_t tsc_per_us = 0;
+
+/* Back buffers are rendered at 1/render_scale of the screen resolution */
+static uint8_t render_scale = 1;
+static uint8_t* row_buffer = NULL; /* One upscaled screen row */
+
+/* Back buffers may hold palette indices regardless of the mode */
+static buffer_format back_buffer_format = BUFFER_NATIVE;
+static uint32_t palette_lut[PALETTE_SIZE]; /* Palette entries packed in the mode's pixel format */
+static uint32_t palette_lut_version;
+static uint8_t* expand_buffer = NULL; /* One row expanded to direct color */
+static void update_palette_lut();
+static void expand_row(uint8_t *dst, const uint8_t *src, uint16_t width, uint8_t pixel_size);
+
+/* VRAM may hold a canvas larger than the screen, which shows the window at the display start */
+static size_t vram_mapped_size;
+static uint16_t virtual_x_res, virtual_y_res;
+static uint16_t display_x, display_y;
 
 void *retry_lm_alloc(size_t size, mmap_t *mmap){
     void *result = NULL;
@@ -63,6 +130,50 @@ int vbe_get_mode_info_2(uint16_t mode, vbe_mode_info_t * vmi_p) {
     return VBE_OK;
 }
 
+/*
+ * Returns the adapter's memory in bytes, from the controller info, or 0 if it can not be read.
+ * Also records the VBE version.
+ */
+static size_t get_total_memory(){
+
+    struct reg86u r;
+    mmap_t mmap;
+
+    /* Reset the struct values */
+    memset(&r, 0, sizeof(r));
+
+    /* Allocate memory block in low memory area */
+    if (retry_lm_alloc(sizeof(VbeInfoBlock), &mmap) == NULL) {
+        printf("(%s): lm_alloc() failed\n", __func__);
+        return 0;
+    }
+
+    /* Ask for the VBE 2.0 fields */
+    memcpy(mmap.virt, "VBE2", 4);
+
+    /* Build the struct */
+    r.u.b.ah = VBE_FUNC;
+    r.u.b.al = RETURN_VBE_CONTROLLER_INFO;
+    r.u.w.es = PB2BASE(mmap.phys);
+    r.u.w.di = PB2OFF(mmap.phys);
+    r.u.b.intno = VIDEO_CARD_SRV;
+
+    /* BIOS Call */
+    if( sys_int86(&r) != FUNC_SUCCESS || r.u.w.ax != FUNC_RETURN_OK ) {
+        lm_free(&mmap);
+        printf("(%s): couldnt read the controller info\n", __func__);
+        return 0;
+    }
+
+    size_t total = (size_t) ((VbeInfoBlock *) mmap.virt)->TotalMemory * VBE_MEMORY_BLOCK_SIZE;
+    vbe_version = ((VbeInfoBlock *) mmap.virt)->VbeVersion;
+
+    /* Free allocated memory */
+    lm_free(&mmap);
+
+    return total;
+}
+
 int set_video_mode(uint16_t mode){
 
     struct reg86u r;
@@ -84,10 +195,319 @@ int set_video_mode(uint16_t mode){
     return VBE_OK;
 }
 
+/*
+ * Fills a CRTCInfoBlock for the given resolution and refresh rate with the Generalized Timing Formula
+ */
+static void compute_gtf_timings(uint16_t x_res, uint16_t y_res, uint16_t hz, CRTCInfoBlock *crtc){
+
+    memset(crtc, 0, sizeof(*crtc));
+
+    /* Line period, so the visible lines and the minimum porch fit in the frame after the vertical sync */
+    uint64_t h_period_ns = (1000000000ull / hz - GTF_MIN_VSYNC_BP_NS) / (y_res + GTF_MIN_PORCH_LINES);
+    uint32_t vsync_bp_lines = (GTF_MIN_VSYNC_BP_NS + h_period_ns / 2) / h_period_ns;
+
+    crtc->VerticalSyncStart = y_res + GTF_MIN_PORCH_LINES;
+    crtc->VerticalSyncEnd = crtc->VerticalSyncStart + GTF_VSYNC_LINES;
+    crtc->VerticalTotal = y_res + GTF_MIN_PORCH_LINES + vsync_bp_lines;
+
+    /* Horizontal blanking takes the ideal duty cycle, rounded to a multiple of two character cells */
+    uint64_t duty = GTF_DUTY_C - GTF_DUTY_M * h_period_ns / 1000;
+    uint64_t cells = 2 * GTF_CELL_GRANULARITY;
+    uint64_t h_blank = (x_res * duty + (100000 - duty) * cells / 2) / ((100000 - duty) * cells) * cells;
+
+    crtc->HorizontalTotal = x_res + h_blank;
+    uint32_t hsync_width = (crtc->HorizontalTotal * GTF_HSYNC_PERCENT / 100 + GTF_CELL_GRANULARITY / 2) / GTF_CELL_GRANULARITY * GTF_CELL_GRANULARITY;
+    crtc->HorizontalSyncEnd = x_res + h_blank / 2;
+    crtc->HorizontalSyncStart = crtc->HorizontalSyncEnd - hsync_width;
+
+    crtc->Flags = CRTC_HSYNC_NEGATIVE;
+    crtc->PixelClock = (uint32_t) (crtc->HorizontalTotal * 1000000000ull / h_period_ns);
+}
+
+/*
+ * Asks the adapter for the pixel clock closest to the requested one, for the given mode
+ */
+static int get_closest_pixel_clock(uint16_t mode, uint32_t *clock){
+
+    struct reg86u r;
+
+    /* Reset the struct values */
+    memset(&r, 0, sizeof(r));
+
+    /* Build the struct */
+    r.u.b.ah = VBE_FUNC;
+    r.u.b.al = GET_SET_PIXEL_CLOCK;
+    r.u.b.bl = GET_CLOSEST_PIXEL_CLOCK;
+    r.u.l.ecx = *clock;
+    r.u.w.dx = mode;
+    r.u.b.intno = VIDEO_CARD_SRV;
+
+    /* BIOS Call */
+    if( sys_int86(&r) != FUNC_SUCCESS ) {
+        printf("(%s): sys_int86() failed \n", __func__);
+        return VBE_SYS_INT86_FAILED;
+    }
+
+    /* Verify the return for errors */
+    if (r.u.w.ax != FUNC_RETURN_OK) {
+        printf("(%s): sys_int86() return in ax was different from OK \n", __func__);
+        return VBE_INVALID_RETURN;
+    }
+
+    *clock = r.u.l.ecx;
+    return VBE_OK;
+}
+
+/*
+ * Sets a mode with custom timings for the requested refresh rate, recording the rate achieved
+ */
+static int set_video_mode_refresh(uint16_t mode, uint16_t hz){
+
+    CRTCInfoBlock crtc;
+    compute_gtf_timings(get_x_res(), get_y_res(), hz, &crtc);
+
+    int res;
+    uint32_t clock = crtc.PixelClock;
+    if((res = get_closest_pixel_clock(mode, &clock)) != VBE_OK)
+        return res;
+    crtc.PixelClock = clock;
+    crtc.RefreshRate = (uint16_t) ((uint64_t) crtc.PixelClock * 100 / ((uint32_t) crtc.HorizontalTotal * crtc.VerticalTotal));
+
+    struct reg86u r;
+    mmap_t mmap;
+
+    /* Reset the struct values */
+    memset(&r, 0, sizeof(r));
+
+    /* The timings are passed in low memory */
+    if (retry_lm_alloc(sizeof(CRTCInfoBlock), &mmap) == NULL) {
+        printf("(%s): lm_alloc() failed\n", __func__);
+        return VBE_LM_ALLOC_FAILED;
+    }
+    memcpy(mmap.virt, &crtc, sizeof(CRTCInfoBlock));
+
+    /* Build the struct */
+    r.u.b.ah = VBE_FUNC;
+    r.u.b.al = SET_VBE_MODE;
+    r.u.w.bx = LINEAR_FRAME_BUFFER | USE_CRTC_INFO | mode;
+    r.u.w.es = PB2BASE(mmap.phys);
+    r.u.w.di = PB2OFF(mmap.phys);
+    r.u.b.intno = VIDEO_CARD_SRV;
+
+    /* BIOS Call */
+    if( sys_int86(&r) != FUNC_SUCCESS || r.u.w.ax != FUNC_RETURN_OK ) {
+        lm_free(&mmap);
+        printf("(%s): the adapter refused the custom timings\n", __func__);
+        return VBE_INVALID_RETURN;
+    }
+
+    /* Free allocated memory */
+    lm_free(&mmap);
+
+    refresh_rate = crtc.RefreshRate;
+    return VBE_OK;
+}
+
+/*
+ * Copies the VBE protected mode interface out of the video BIOS and finds its entry points.
+ * Interfaces that need access to memory areas would need selectors, so they are not used.
+ */
+static void init_pm_interface(){
+
+    free(pm_table);
+    pm_table = NULL;
+    pm_set_display_start = pm_set_palette = NULL;
+
+    if(vbe_version < VBE_VERSION_2)
+        return;
+
+    struct reg86u r;
+
+    /* Reset the struct values */
+    memset(&r, 0, sizeof(r));
+
+    /* Build the struct */
+    r.u.b.ah = VBE_FUNC;
+    r.u.b.al = RETURN_PM_INTERFACE;
+    r.u.b.bl = GET_PM_TABLE;
+    r.u.b.intno = VIDEO_CARD_SRV;
+
+    /* BIOS Call, ES:DI points to the table and CX holds its length */
+    if(sys_int86(&r) != FUNC_SUCCESS || r.u.w.ax != FUNC_RETURN_OK || r.u.w.cx < 4 * sizeof(uint16_t))
+        return;
+
+    /* Run it from a copy, the table lives in the BIOS ROM */
+    uint16_t *table = malloc(r.u.w.cx);
+    if(table == NULL)
+        return;
+    memcpy(table, lm_base + ((uint32_t) r.u.w.es << 4) + r.u.w.di, r.u.w.cx);
+
+    if(table[PM_PORTS_MEMORY] != 0){
+        /* Ports come first, then the memory areas, each list ending in PM_LIST_END */
+        const uint16_t *list = (const uint16_t *) ((uint8_t *) table + table[PM_PORTS_MEMORY]);
+        bool uses_ports = (*list != PM_LIST_END);
+        while(*list != PM_LIST_END)
+            list++;
+
+        if(list[1] != PM_LIST_END){
+            printf("(%s) The protected mode interface needs memory selectors, using sys_int86\n", __func__);
+            free(table);
+            return;
+        }
+
+        /* The entry points access the listed ports directly */
+        if(uses_ports && sys_enable_iop(SELF) != OK){
+            printf("(%s) Couldnt enable I/O, using sys_int86\n", __func__);
+            free(table);
+            return;
+        }
+    }
+
+    pm_table = table;
+    pm_set_display_start = (uint8_t *) table + table[PM_SET_DISPLAY_START];
+    pm_set_palette = (uint8_t *) table + table[PM_SET_PALETTE];
+}
+
+/*
+ * Calls a protected mode interface entry point with the registers of the real mode function, returning AX
+ */
+static uint16_t call_pm(void *entry, uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx, void *edi){
+    __asm__ __volatile__("call *%[entry]"
+                         : "+a" (eax), "+b" (ebx), "+c" (ecx), "+d" (edx), "+D" (edi), [entry] "+S" (entry)
+                         :
+                         : "memory", "cc");
+    return (uint16_t) eax;
+}
+
+static void copy_memcpy(uint8_t *dst, const uint8_t *src, size_t size){
+    memcpy(dst, src, size);
+}
+
+static void copy_rep_movsd(uint8_t *dst, const uint8_t *src, size_t size){
+    size_t dwords = size / 4;
+
+    /* Move whole double words, the string instruction advances both pointers */
+    __asm__ __volatile__("cld\n\trep movsl"
+                         : "+D" (dst), "+S" (src), "+c" (dwords)
+                         :
+                         : "memory");
+
+    /* Remaining bytes */
+    memcpy(dst, src, size % 4);
+}
+
+static void copy_stream(uint8_t *dst, const uint8_t *src, size_t size){
+#ifdef __SSE2__
+    /* Non-temporal stores need a 16 byte aligned destination */
+    size_t head = (16 - ((uintptr_t) dst & 15)) & 15;
+    if(head > size)
+        head = size;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    /* Stream 64 bytes per iteration, bypassing the cache */
+    for(; size >= 64; size -= 64, dst += 64, src += 64){
+        __m128i a = _mm_loadu_si128((const __m128i *) src);
+        __m128i b = _mm_loadu_si128((const __m128i *) (src + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *) (src + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *) (src + 48));
+        _mm_stream_si128((__m128i *) dst, a);
+        _mm_stream_si128((__m128i *) (dst + 16), b);
+        _mm_stream_si128((__m128i *) (dst + 32), c);
+        _mm_stream_si128((__m128i *) (dst + 48), d);
+    }
+    for(; size >= 16; size -= 16, dst += 16, src += 16)
+        _mm_stream_si128((__m128i *) dst, _mm_loadu_si128((const __m128i *) src));
+
+    /* Make the streamed data visible before returning */
+    _mm_sfence();
+#endif
+    memcpy(dst, src, size);
+}
+
+static void copy_rows(uint8_t *dst, const uint8_t *src, size_t size){
+    size_t row_size = (size_t) get_x_res() * calculate_size_in_bytes(get_bits_per_pixel());
+
+    /* Copy one scanline at a time */
+    while(size > row_size){
+        memcpy(dst, src, row_size);
+        dst += row_size;
+        src += row_size;
+        size -= row_size;
+    }
+    memcpy(dst, src, size);
+}
+
+/*
+ * Measures the time stamp counter frequency against the kernel's delay
+ */
+static void calibrate_tsc(){
+    uint64_t start = read_tsc();
+    if(micro_delay(TSC_CALIBRATION_US) != OK){
+        printf("(%s) Couldnt calibrate the time stamp counter\n", __func__);
+        tsc_per_us = 1000; /* Assume 1 GHz */
+        return;
+    }
+    tsc_per_us = (uint32_t) ((read_tsc() - start) / TSC_CALIBRATION_US);
+    if(tsc_per_us == 0)
+        tsc_per_us = 1;
+}
+
+/*
+ * Times every copy strategy against the mapped framebuffer and selects the fastest.
+ * The test buffer is zeroed so the (still black) screen does not change.
+ */
+static void calibrate_present_copy(){
+
+    size_t size = get_frame_size();
+    if(size > PRESENT_CALIBRATION_SIZE)
+        size = PRESENT_CALIBRATION_SIZE;
+
+    uint8_t *test = calloc(size, 1);
+    if(test == NULL){
+        printf("(%s) Couldnt allocate calibration buffer, using memcpy\n", __func__);
+        present_strategy = PRESENT_COPY_MEMCPY;
+        return;
+    }
+
+    uint64_t best_cycles = UINT64_MAX;
+    for(unsigned s = 0; s < PRESENT_COPY_COUNT; s++){
+        /* Warm up once, then keep the best of the timed rounds */
+        present_copies[s](mapped_mem, test, size);
+
+        for(unsigned round = 0; round < PRESENT_CALIBRATION_ROUNDS; round++){
+            uint64_t start = read_tsc();
+            present_copies[s](mapped_mem, test, size);
+            uint64_t cycles = read_tsc() - start;
+
+            if(cycles < best_cycles){
+                best_cycles = cycles;
+                present_strategy = s;
+            }
+        }
+    }
+
+    free(test);
+}
+
+/*
+ * Makes the screen surface match the virtual canvas
+ */
+static void update_screen_surface(){
+    screen_surface.width = virtual_x_res;
+    screen_surface.height = virtual_y_res;
+    screen_surface.pixel_size = calculate_size_in_bytes(get_bits_per_pixel());
+    screen_surface.pitch = (size_t) virtual_x_res * screen_surface.pixel_size;
+    screen_surface.format = BUFFER_NATIVE;
+    screen_surface.pixels = mapped_mem;
+}
+
 void* (vg_init)(uint16_t mode){
 
     /* Initialize lower memory region */
-    if(lm_init(true) == NULL){
+    if((lm_base = lm_init(true)) == NULL){
         printf("(%s) Couldnt init lm\n", __func__);
         return NULL;
     }
@@ -101,8 +521,10 @@ void* (vg_init)(uint16_t mode){
     struct minix_mem_range mr; /* physical memory range */
     unsigned int vram_base = vbe_mode_info.PhysBasePtr; /* VRAM’s physical addresss */
 
-    unsigned int vram_size = vbe_mode_info.XResolution * vbe_mode_info.YResolution * vbe_mode_info.BitsPerPixel ; /* VRAM’s size, but you can use
-    the frame-buffer size, instead */
+    /* Map the adapter's whole memory, so a virtual canvas larger than the screen fits */
+    size_t vram_size = get_total_memory();
+    if(vram_size < get_frame_size())
+        vram_size = get_frame_size();
 
     void *video_mem; /* frame-buffer VM address */
 
@@ -120,11 +542,58 @@ void* (vg_init)(uint16_t mode){
 
     /* Store the mapped memmory pointer in mapped_mem */
     mapped_mem = video_mem;
+    vram_mapped_size = vram_size;
+
+    /* The canvas starts as large as the screen */
+    virtual_x_res = get_x_res();
+    virtual_y_res = get_y_res();
+    display_x = display_y = 0;
+    update_screen_surface();
 
-    /* Set video mode */
-    if(set_video_mode(mode) != OK)
+    /* Allocate the shadow copy of the presented frame */
+    free(shadow_mem);
+    shadow_mem = malloc(get_frame_size());
+    shadow_valid = false;
+    if(shadow_mem == NULL)
+        printf("(%s) Couldnt allocate shadow frame, presenting without compare\n", __func__);
+
+    /* Start at full resolution in the native format, with room to upscale and expand one row */
+    size_t row_size = (size_t) get_x_res() * calculate_size_in_bytes(get_bits_per_pixel());
+    render_scale = 1;
+    back_buffer_format = BUFFER_NATIVE;
+    /* Palette entries are packed for the new mode on next use */
+    palette_lut_version = palette_version() - 1;
+    free(row_buffer);
+    free(expand_buffer);
+    row_buffer = malloc(row_size);
+    expand_buffer = malloc(row_size);
+
+    /* Set video mode, with custom timings if a refresh rate was requested */
+    refresh_rate = 0;
+    bool custom_timings = requested_refresh != 0 && vbe_version >= VBE_VERSION_3 &&
+                          set_video_mode_refresh(mode, requested_refresh) == VBE_OK;
+    if(!custom_timings && set_video_mode(mode) != OK)
         return NULL;
 
+    /* Page flips and palette changes skip sys_int86 when possible */
+    init_pm_interface();
+
+    /* Pick the fastest way of copying to this framebuffer */
+    calibrate_present_copy();
+
+    /* Retrace waits are measured in microseconds */
+    calibrate_tsc();
+    present_sync_mode = PRESENT_SYNC_NONE;
+    vg_reset_present_stats();
+
+    /* Pick the blending kernels for this pixel format */
+    if(blend_init() != OK)
+        printf("(%s) Blending is not available in this mode\n", __func__);
+
+    /* Preallocate the flood fill stack */
+    if(fill_init() != OK)
+        printf("(%s) Flood fills are not available\n", __func__);
+
     return video_mem;    
 }
 
@@ -137,35 +606,209 @@ int (vg_draw_hline)(uint16_t x, uint16_t y, uint16_t len, uint32_t color) {
         return VBE_INVALID_COORDS;		
     }
 
-    /* Direct color */
-    if (get_memory_model() == DIRECT_COLOR_MODE) {
+    /* Both color modes go through the span fill */
+    if (get_memory_model() != DIRECT_COLOR_MODE && get_memory_model() != INDEXED_COLOR_MODE) {
+        printf("(%s) Unsuported color mode\n", __func__);
+        return VBE_INVALID_COLOR_MODE;
+    }
 
-        /* Calculate size in bytes each pixel occupies */
-        uint8_t pixel_size = calculate_size_in_bytes(get_bits_per_pixel());
+    return fill_span_on(&screen_surface, x, y, len, color);
+}
 
-        for (uint32_t i = 0; i < len; i++){
-            /* Check if x is outside of range */
-            if (x+i >= get_x_res())
-            return VBE_OK;
+void fill_pixels(uint8_t *dst, uint32_t color, size_t count, uint8_t pixel_size) {
 
-            /* Color the pixel */
-            uint32_t y_coord = y * get_x_res() * pixel_size;
-            uint32_t x_coord = (x + i) * pixel_size;  
-            memcpy(mapped_mem + y_coord + x_coord, &color, pixel_size);
+    size_t i = 0;
+    switch (pixel_size) {
+        case 1:
+            memset(dst, (uint8_t) color, count);
+            return;
+        case 2: {
+            uint16_t *out = (uint16_t *) dst;
+#ifdef __SSE2__
+            __m128i v = _mm_set1_epi16((int16_t) color);
+            for (; i + 8 <= count; i += 8)
+                _mm_storeu_si128((__m128i *) (out + i), v);
+#endif
+            for (; i < count; i++)
+                out[i] = (uint16_t) color;
+            return;
+        }
+        case 4: {
+            uint32_t *out = (uint32_t *) dst;
+#ifdef __SSE2__
+            __m128i v = _mm_set1_epi32((int32_t) color);
+            for (; i + 4 <= count; i += 4)
+                _mm_storeu_si128((__m128i *) (out + i), v);
+#endif
+            for (; i < count; i++)
+                out[i] = color;
+            return;
         }
+        default:
+            for (; i < count; i++, dst += pixel_size)
+                memcpy(dst, &color, pixel_size);
+            return;
     }
-    /* Indexed color */
-    else if (get_memory_model() == INDEXED_COLOR_MODE) {
-        memset(mapped_mem + y * get_x_res() + x, (uint8_t)color, (len > (get_x_res() - x) ? get_x_res() - x : len));
+}
+
+int fill_span_on(surface_t *surface, int32_t x, int32_t y, int32_t len, uint32_t color) {
+
+    /* Clip the span to the surface */
+    if (x < 0) {
+        len += x;
+        x = 0;
     }
-    else {
-        printf("(%s) Unsuported color mode, __func__\n");
-        return VBE_INVALID_COLOR_MODE;
+    if (x + len > surface->width)
+        len = surface->width - x;
+    if (y < 0 || y >= surface->height || len <= 0)
+        return VBE_OK;
+
+    fill_pixels(surface_at(surface, x, y), color, len, surface->pixel_size);
+    vg_target_modified(surface->pixels);
+    return VBE_OK;
+}
+
+/*
+ * Combines len bytes with a pattern that repeats every 16 bytes
+ */
+static void rop_bytes(uint8_t *dst, const uint8_t *pattern, size_t len, raster_op op) {
+
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i v = _mm_loadu_si128((const __m128i *) pattern);
+    for (; i + 16 <= len; i += 16) {
+        __m128i d = _mm_loadu_si128((const __m128i *) (dst + i));
+        switch (op) {
+            case ROP_XOR: d = _mm_xor_si128(d, v); break;
+            case ROP_AND: d = _mm_and_si128(d, v); break;
+            default: d = _mm_or_si128(d, v); break;
+        }
+        _mm_storeu_si128((__m128i *) (dst + i), d);
+    }
+#endif
+    for (; i < len; i++) {
+        switch (op) {
+            case ROP_XOR: dst[i] ^= pattern[i % 16]; break;
+            case ROP_AND: dst[i] &= pattern[i % 16]; break;
+            default: dst[i] |= pattern[i % 16]; break;
+        }
+    }
+}
+
+void rop_pixels(uint8_t *dst, uint32_t color, size_t count, uint8_t pixel_size, raster_op op) {
+
+    if(op == ROP_COPY){
+        fill_pixels(dst, color, count, pixel_size);
+        return;
     }
 
+    /* The operations work bytewise, so sizes that divide 16 combine with a repeated color */
+    if(16 % pixel_size == 0){
+        uint8_t pattern[16];
+        for(uint8_t i = 0; i < 16; i += pixel_size)
+            memcpy(pattern + i, &color, pixel_size);
+        rop_bytes(dst, pattern, count * pixel_size, op);
+        return;
+    }
+
+    uint8_t pattern[16];
+    memcpy(pattern, &color, sizeof(color));
+    for(size_t i = 0; i < count; i++, dst += pixel_size)
+        rop_bytes(dst, pattern, pixel_size, op);
+}
+
+int rop_span_on(surface_t *surface, int32_t x, int32_t y, int32_t len, uint32_t color, raster_op op) {
+
+    /* Clip the span to the surface */
+    if (x < 0) {
+        len += x;
+        x = 0;
+    }
+    if (x + len > surface->width)
+        len = surface->width - x;
+    if (y < 0 || y >= surface->height || len <= 0)
+        return VBE_OK;
+
+    rop_pixels(surface_at(surface, x, y), color, len, surface->pixel_size, op);
+    vg_target_modified(surface->pixels);
+    return VBE_OK;
+}
+
+int draw_rectangle_rop_on(int16_t x, int16_t y, uint16_t width, uint16_t height, uint32_t color, raster_op op, surface_t *surface) {
+    for (uint16_t i = 0; i < height; i++)
+        rop_span_on(surface, x, y + i, width, color, op);
+    return VBE_OK;
+}
+
+int draw_rectangle_outline_rop_on(int16_t x, int16_t y, uint16_t width, uint16_t height, uint32_t color, raster_op op, surface_t *surface) {
+
+    if (width == 0 || height == 0)
+        return VBE_OK;
+
+    /* Corners belong to the top and bottom rows only, so XOR does not cancel them out */
+    rop_span_on(surface, x, y, width, color, op);
+    if (height > 1)
+        rop_span_on(surface, x, y + height - 1, width, color, op);
+
+    for (int32_t i = 1; i + 1 < height; i++) {
+        rop_span_on(surface, x, y + i, 1, color, op);
+        if (width > 1)
+            rop_span_on(surface, x + width - 1, y + i, 1, color, op);
+    }
     return VBE_OK;
 }
 
+int draw_pixmap_rop_on(const char *pixmap, int16_t x, int16_t y, int width, int height, raster_op op, surface_t *surface) {
+
+    uint8_t pixel_size = surface->pixel_size;
+
+    /* Clip the pixmap to the surface */
+    int32_t first_col = (x < 0 ? -x : 0), first_row = (y < 0 ? -y : 0);
+    int32_t cols = (x + width > surface->width ? surface->width - x : width) - first_col;
+    int32_t rows = (y + height > surface->height ? surface->height - y : height) - first_row;
+    if (cols <= 0 || rows <= 0)
+        return VBE_OK;
+
+    size_t row_bytes = (size_t) cols * pixel_size;
+    for (int32_t i = first_row; i < first_row + rows; i++) {
+        uint8_t *dst = surface_at(surface, x + first_col, y + i);
+        const uint8_t *src = (const uint8_t *) pixmap + ((size_t) i * width + first_col) * pixel_size;
+
+        if (op == ROP_COPY) {
+            memcpy(dst, src, row_bytes);
+            continue;
+        }
+
+        /* Each 16 byte block of the row is its own pattern */
+        for (size_t done = 0; done < row_bytes; done += 16)
+            rop_bytes(dst + done, src + done, (row_bytes - done < 16 ? row_bytes - done : 16), op);
+    }
+
+    vg_target_modified(surface->pixels);
+    return VBE_OK;
+}
+
+int vg_draw_hline_rop(uint16_t x, uint16_t y, uint16_t len, uint32_t color, raster_op op) {
+
+    /* Check if out of bounds */
+    if (x >= get_x_res() || y >= get_y_res()) {
+        printf("(%s) Invalid coordinates: x=%d, y=%d\n", __func__, x, y);
+        return VBE_INVALID_COORDS;
+    }
+
+    return rop_span_on(&screen_surface, x, y, len, color, op);
+}
+
+int vg_draw_rectangle_rop(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint32_t color, raster_op op) {
+
+    /* Check if out of bounds */
+    if (x >= get_x_res() || y >= get_y_res()) {
+        printf("(%s) Invalid coordinates: x=%d, y=%d\n", __func__, x, y);
+        return VBE_INVALID_COORDS;
+    }
+
+    return draw_rectangle_rop_on(x, y, width, height, color, op, &screen_surface);
+}
 
 int (vg_draw_rectangle)(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint32_t color) {
 
@@ -187,36 +830,751 @@ int (vg_draw_rectangle)(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
     return VBE_OK;
 }
 
-void draw_pixmap_on(const char *pixmap, uint16_t x, uint16_t y, int width, int height, uint8_t *buffer){
+int draw_pixmap_on(const char *pixmap, int16_t x, int16_t y, int width, int height, surface_t *surface){
 
-    /* Iterate lines */
-    for(int i = 0; i < height; i++){
-        /* Y is out of bounds */
-        if((i+y) >= get_y_res())
-            break;
+    /* Indices are already in an indexed surface's format */
+    if(surface->pixel_size == 1)
+        return draw_pixmap_rop_on(pixmap, x, y, width, height, ROP_COPY, surface);
 
-        /* Iterate columns */
-        for(int j = 0; j<width; j++){         
-            /* X is out of bounds */
-            if((j+x) >= get_x_res())
-                break;
-            /* Draw the pixmap pixel */
-            buffer[(y+i)*get_x_res() + x + j] = pixmap[i*width + j];
-        }
-    }
+    /* Clip the pixmap to the surface */
+    int32_t first_col = (x < 0 ? -x : 0), first_row = (y < 0 ? -y : 0);
+    int32_t cols = (x + width > surface->width ? surface->width - x : width) - first_col;
+    int32_t rows = (y + height > surface->height ? surface->height - y : height) - first_row;
+    if(cols <= 0 || rows <= 0)
+        return VBE_OK;
+
+    /* Direct color surfaces get each index through the palette, as indexed back buffers do on present */
+    update_palette_lut();
+    for(int32_t i = first_row; i < first_row + rows; i++)
+        expand_row(surface_at(surface, x + first_col, y + i), (const uint8_t *) pixmap + (size_t) i * width + first_col, cols, surface->pixel_size);
+
+    vg_target_modified(surface->pixels);
+    return VBE_OK;
 }
 
 void (draw_pixmap)(const char *pixmap, uint16_t x, uint16_t y, int width, int height){
-    draw_pixmap_on(pixmap, x, y, width, height, mapped_mem);
+    draw_pixmap_on(pixmap, x, y, width, height, &screen_surface);
+}
+
+void vg_target_modified(const uint8_t *buffer){
+    /* Drawing straight to VRAM invalidates the shadow copy, surfaces may start anywhere in it */
+    if(buffer >= mapped_mem && buffer < mapped_mem + vram_mapped_size)
+        shadow_valid = false;
+}
+
+surface_t *get_screen_surface(){
+    return &screen_surface;
+}
+
+void surface_from_buffer(surface_t *surface, uint8_t *buffer){
+    if(buffer == mapped_mem){
+        *surface = screen_surface;
+        return;
+    }
+
+    surface->width = get_buffer_x_res();
+    surface->height = get_buffer_y_res();
+    surface->pixel_size = get_buffer_bytes_per_pixel();
+    surface->pitch = (size_t) surface->width * surface->pixel_size;
+    surface->format = back_buffer_format;
+    surface->pixels = buffer;
+}
+
+/*
+ * Moves rows of bytes within a buffer, picking the row order that does not overwrite unread source rows
+ */
+static void move_rows(uint8_t *base, size_t pitch, size_t src, size_t dst, size_t row_bytes, uint16_t rows){
+
+    /* Whole rows are contiguous, so they move as a single block */
+    if(row_bytes == pitch){
+        memmove(base + dst, base + src, row_bytes * rows);
+        return;
+    }
+
+    if(dst > src){
+        for(int32_t i = rows - 1; i >= 0; i--)
+            memmove(base + dst + i * pitch, base + src + i * pitch, row_bytes);
+    }
+    else {
+        for(int32_t i = 0; i < rows; i++)
+            memmove(base + dst + i * pitch, base + src + i * pitch, row_bytes);
+    }
+}
+
+int move_region_on(surface_t *surface, int16_t src_x, int16_t src_y, uint16_t width, uint16_t height, int16_t dst_x, int16_t dst_y){
+
+    uint16_t x_res = surface->width, y_res = surface->height;
+    uint8_t pixel_size = surface->pixel_size;
+
+    /* Clip the source so that both it and the destination are inside the buffer */
+    int32_t dx = dst_x - src_x, dy = dst_y - src_y;
+    int32_t x0 = src_x, y0 = src_y, x1 = src_x + width, y1 = src_y + height;
+    if(x0 < 0) x0 = 0;
+    if(x0 < -dx) x0 = -dx;
+    if(y0 < 0) y0 = 0;
+    if(y0 < -dy) y0 = -dy;
+    if(x1 > x_res) x1 = x_res;
+    if(x1 > x_res - dx) x1 = x_res - dx;
+    if(y1 > y_res) y1 = y_res;
+    if(y1 > y_res - dy) y1 = y_res - dy;
+    if(x0 >= x1 || y0 >= y1 || (dx == 0 && dy == 0))
+        return VBE_OK;
+
+    size_t pitch = surface->pitch;
+    size_t src = y0 * pitch + (size_t) x0 * pixel_size;
+    size_t dst = (y0 + dy) * pitch + (size_t) (x0 + dx) * pixel_size;
+    size_t row_bytes = (size_t) (x1 - x0) * pixel_size;
+
+    move_rows(surface->pixels, pitch, src, dst, row_bytes, y1 - y0);
+
+    /* The shadow copy of VRAM stays valid if it moves along, which needs the same layout */
+    if(surface->pixels == mapped_mem && shadow_valid && pitch == (size_t) get_x_res() * pixel_size &&
+       virtual_x_res == get_x_res() && virtual_y_res == get_y_res())
+        move_rows(shadow_mem, pitch, src, dst, row_bytes, y1 - y0);
+    else
+        vg_target_modified(surface->pixels);
+
+    return VBE_OK;
+}
+
+int scroll_region_on(surface_t *surface, int16_t x, int16_t y, uint16_t width, uint16_t height, int16_t dx, int16_t dy){
+
+    /* Nothing stays inside the rectangle */
+    if(abs(dx) >= width || abs(dy) >= height)
+        return VBE_OK;
+
+    /* The part of the rectangle that is still inside it after moving */
+    int16_t src_x = (dx < 0 ? x - dx : x), src_y = (dy < 0 ? y - dy : y);
+    return move_region_on(surface, src_x, src_y, width - abs(dx), height - abs(dy), src_x + dx, src_y + dy);
+}
+
+/*
+ * Validates a blit onto a direct color target and clips its width.
+ * Returns the pointer to the first destination pixel, or NULL if nothing is drawn.
+ */
+static uint8_t *blend_target(surface_t *surface, uint16_t x, uint16_t y, int width, int *visible){
+
+    /* Blending needs direct color pixels */
+    if(!blend_supported() || surface->format != BUFFER_NATIVE)
+        return NULL;
+
+    if(x >= surface->width || y >= surface->height || width <= 0)
+        return NULL;
+
+    *visible = (width > surface->width - x ? surface->width - x : width);
+    vg_target_modified(surface->pixels);
+
+    return surface_at(surface, x, y);
+}
+
+int draw_argb_on(const uint32_t *image, uint16_t x, uint16_t y, int width, int height, surface_t *surface){
+
+    int visible;
+
+    uint8_t *dst = blend_target(surface, x, y, width, &visible);
+    if(dst == NULL)
+        return (blend_supported() ? VBE_OK : VBE_INVALID_COLOR_MODE);
+
+    /* Blend one row at a time, stopping at the bottom of the target */
+    for(int i = 0; i < height && y + i < surface->height; i++, dst += surface->pitch)
+        blend_span(dst, image + (size_t) i * width, visible);
+
+    return VBE_OK;
+}
+
+int draw_translucent_on(const uint8_t *image, uint16_t x, uint16_t y, int width, int height, uint8_t alpha, surface_t *surface){
+
+    int visible;
+
+    uint8_t *dst = blend_target(surface, x, y, width, &visible);
+    if(dst == NULL)
+        return (blend_supported() ? VBE_OK : VBE_INVALID_COLOR_MODE);
+
+    for(int i = 0; i < height && y + i < surface->height; i++, dst += surface->pitch)
+        blend_span_const(dst, image + (size_t) i * width * surface->pixel_size, visible, alpha);
+
+    return VBE_OK;
+}
+
+int draw_translucent_rectangle_on(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint32_t color, uint8_t alpha, surface_t *surface){
+
+    int visible;
+
+    uint8_t *dst = blend_target(surface, x, y, width, &visible);
+    if(dst == NULL)
+        return (blend_supported() ? VBE_OK : VBE_INVALID_COLOR_MODE);
+
+    /* A short row of the solid color is blended repeatedly along each line */
+    uint8_t chunk[TRANSLUCENT_CHUNK * sizeof(uint32_t)];
+    for(unsigned i = 0; i < TRANSLUCENT_CHUNK; i++)
+        memcpy(chunk + i * surface->pixel_size, &color, surface->pixel_size);
+
+    for(int i = 0; i < height && y + i < surface->height; i++, dst += surface->pitch){
+        for(int done = 0; done < visible; done += TRANSLUCENT_CHUNK){
+            int count = (visible - done > TRANSLUCENT_CHUNK ? TRANSLUCENT_CHUNK : visible - done);
+            blend_span_const(dst + (size_t) done * surface->pixel_size, chunk, count, alpha);
+        }
+    }
+
+    return VBE_OK;
 }
 
 void (clear_buffer)(uint8_t *buffer, uint8_t color){
-    memset(buffer, color, get_x_res() * get_y_res());
+    /* Every byte of the buffer takes the color, whatever the pixel size */
+    surface_t surface;
+    surface_from_buffer(&surface, buffer);
+    clear_surface(&surface, color * 0x01010101u);
+}
+
+
+/*
+ * Returns true if the PRESENT_BLOCK_SIZE bytes starting at a and b differ
+ */
+static inline bool block_differs(const uint8_t *a, const uint8_t *b){
+#ifdef __SSE2__
+    __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) a), _mm_loadu_si128((const __m128i *) b));
+    for(unsigned i = 16; i < PRESENT_BLOCK_SIZE; i += 16)
+        eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (a + i)), _mm_loadu_si128((const __m128i *) (b + i))));
+    return _mm_movemask_epi8(eq) != 0xFFFF;
+#else
+    return memcmp(a, b, PRESENT_BLOCK_SIZE) != 0;
+#endif
 }
 
+/*
+ * Writes size bytes of src to VRAM at the given offset.
+ * With a valid shadow copy only the blocks that differ from it are written,
+ * consecutive changed blocks being merged so each run is copied at once.
+ */
+static void present_region(size_t vram_offset, size_t shadow_offset, const uint8_t *src, size_t size){
+
+    uint8_t *vram = mapped_mem + vram_offset;
+    uint8_t *shadow = shadow_mem + shadow_offset;
+
+    /* Without a valid shadow copy every byte has to be written */
+    if(!present_compare || shadow_mem == NULL || !shadow_valid){
+        present_copies[present_strategy](vram, src, size);
+        if(present_compare && shadow_mem != NULL)
+            memcpy(shadow, src, size);
+        return;
+    }
+
+    size_t blocks_end = size - size % PRESENT_BLOCK_SIZE;
+    size_t pos = 0;
+
+    while(pos < blocks_end){
+        /* Skip blocks that are already on screen */
+        if(!block_differs(src + pos, shadow + pos)){
+            pos += PRESENT_BLOCK_SIZE;
+            continue;
+        }
+
+        /* Extend the run while blocks keep changing */
+        size_t run_start = pos;
+        do {
+            pos += PRESENT_BLOCK_SIZE;
+        } while(pos < blocks_end && block_differs(src + pos, shadow + pos));
+
+        present_copies[present_strategy](vram + run_start, src + run_start, pos - run_start);
+        memcpy(shadow + run_start, src + run_start, pos - run_start);
+    }
+
+    /* Remaining bytes that do not fill a whole block */
+    if(blocks_end < size && memcmp(src + blocks_end, shadow + blocks_end, size - blocks_end) != 0){
+        present_copies[present_strategy](vram + blocks_end, src + blocks_end, size - blocks_end);
+        memcpy(shadow + blocks_end, src + blocks_end, size - blocks_end);
+    }
+}
+
+#ifdef __SSE2__
+/*
+ * Stores the 16 bytes of v with every element of elem_size bytes repeated twice
+ */
+static inline void double_elements(uint8_t *dst, __m128i v, uint8_t elem_size){
+    __m128i lo, hi;
+    switch(elem_size){
+        case 1: lo = _mm_unpacklo_epi8(v, v); hi = _mm_unpackhi_epi8(v, v); break;
+        case 2: lo = _mm_unpacklo_epi16(v, v); hi = _mm_unpackhi_epi16(v, v); break;
+        case 4: lo = _mm_unpacklo_epi32(v, v); hi = _mm_unpackhi_epi32(v, v); break;
+        default: lo = _mm_unpacklo_epi64(v, v); hi = _mm_unpackhi_epi64(v, v); break;
+    }
+    _mm_storeu_si128((__m128i *) dst, lo);
+    _mm_storeu_si128((__m128i *) (dst + 16), hi);
+}
+#endif
+
+/*
+ * Expands a row of width pixels, repeating each pixel scale times horizontally
+ */
+static void upscale_row(uint8_t *dst, const uint8_t *src, uint16_t width, uint8_t pixel_size, uint8_t scale){
+
+    size_t bytes = (size_t) width * pixel_size;
+    size_t done = 0;
+
+#ifdef __SSE2__
+    /* Doubling kernels work on element sizes that divide 16 bytes */
+    if(pixel_size != 3){
+        for(; done + 16 <= bytes; done += 16){
+            __m128i v = _mm_loadu_si128((const __m128i *) (src + done));
+            uint8_t *out = dst + done * scale;
+
+            if(scale == 2)
+                double_elements(out, v, pixel_size);
+            else {
+                /* Doubling twice gives 4x, the second pass on pixel pairs */
+                uint8_t tmp[32];
+                double_elements(tmp, v, pixel_size);
+                double_elements(out, _mm_loadu_si128((const __m128i *) tmp), pixel_size * 2);
+                double_elements(out + 32, _mm_loadu_si128((const __m128i *) (tmp + 16)), pixel_size * 2);
+            }
+        }
+    }
+#endif
+
+    /* Remaining pixels */
+    for(; done < bytes; done += pixel_size)
+        for(uint8_t k = 0; k < scale; k++)
+            memcpy(dst + done * scale + k * pixel_size, src + done, pixel_size);
+}
+
+/*
+ * Rebuilds the palette lookup table if the palette changed since it was built
+ */
+static void update_palette_lut(){
+
+    if(palette_lut_version == palette_version())
+        return;
+
+    const palette_color *colors = palette_get();
+    for(unsigned i = 0; i < PALETTE_SIZE; i++)
+        palette_lut[i] = vg_pack_rgb(colors[i].red, colors[i].green, colors[i].blue);
+
+    palette_lut_version = palette_version();
+}
+
+/*
+ * Expands a row of width palette indices into direct color pixels
+ */
+static void expand_row(uint8_t *dst, const uint8_t *src, uint16_t width, uint8_t pixel_size){
+
+    uint16_t i = 0;
+    switch(pixel_size){
+        case 4: {
+            uint32_t *out = (uint32_t *) dst;
+            for(; i + 4 <= width; i += 4){
+                out[i] = palette_lut[src[i]];
+                out[i + 1] = palette_lut[src[i + 1]];
+                out[i + 2] = palette_lut[src[i + 2]];
+                out[i + 3] = palette_lut[src[i + 3]];
+            }
+            for(; i < width; i++)
+                out[i] = palette_lut[src[i]];
+            break;
+        }
+        case 2: {
+            uint16_t *out = (uint16_t *) dst;
+            for(; i + 4 <= width; i += 4){
+                out[i] = (uint16_t) palette_lut[src[i]];
+                out[i + 1] = (uint16_t) palette_lut[src[i + 1]];
+                out[i + 2] = (uint16_t) palette_lut[src[i + 2]];
+                out[i + 3] = (uint16_t) palette_lut[src[i + 3]];
+            }
+            for(; i < width; i++)
+                out[i] = (uint16_t) palette_lut[src[i]];
+            break;
+        }
+        default:
+            for(; i < width; i++, dst += pixel_size)
+                memcpy(dst, &palette_lut[src[i]], pixel_size);
+            break;
+    }
+}
+
+/*
+ * Presents a back buffer row by row, expanding palette indices to direct color
+ * and upscaling each row once before writing it render_scale times.
+ * Rows go to the window of the virtual canvas at the display start.
+ */
+static void present_rows(const uint8_t *buffer){
+
+    uint8_t pixel_size = calculate_size_in_bytes(get_bits_per_pixel());
+    bool expand = (get_buffer_bytes_per_pixel() != pixel_size);
+    size_t src_row = (size_t) get_buffer_x_res() * get_buffer_bytes_per_pixel();
+    size_t dst_row = (size_t) get_x_res() * pixel_size;
+    size_t vram_pitch = (size_t) virtual_x_res * pixel_size;
+    size_t window = (size_t) display_y * vram_pitch + (size_t) display_x * pixel_size;
+
+    if(expand)
+        update_palette_lut();
+
+    for(uint16_t row = 0; row < get_buffer_y_res(); row++){
+        const uint8_t *src = buffer + row * src_row;
+
+        if(expand){
+            expand_row(expand_buffer, src, get_buffer_x_res(), pixel_size);
+            src = expand_buffer;
+        }
+
+        if(render_scale > 1){
+            upscale_row(row_buffer, src, get_buffer_x_res(), pixel_size, render_scale);
+            src = row_buffer;
+        }
+
+        for(uint8_t k = 0; k < render_scale; k++){
+            size_t screen_row = (size_t) row * render_scale + k;
+            present_region(window + screen_row * vram_pitch, screen_row * dst_row, src, dst_row);
+        }
+    }
+}
 
 void swap_buffers(uint8_t *buffer){
-    memcpy(mapped_mem, buffer, get_x_res() * get_y_res());
+
+    uint64_t start = read_tsc();
+    if(present_sync_mode == PRESENT_SYNC_RETRACE && vg_wait_retrace() != VBE_OK)
+        stats.timeouts++;
+    uint64_t copy_start = read_tsc();
+
+    /* Buffers in the screen's own format are presented at once, unless VRAM is a larger canvas */
+    bool contiguous = (virtual_x_res == get_x_res() && display_x == 0 && display_y == 0);
+    if(render_scale == 1 && contiguous && get_buffer_bytes_per_pixel() == calculate_size_in_bytes(get_bits_per_pixel()))
+        present_region(0, 0, buffer, get_frame_size());
+    else
+        present_rows(buffer);
+
+    /* The shadow copy now holds the whole frame */
+    if(present_compare && shadow_mem != NULL)
+        shadow_valid = true;
+
+    uint32_t wait_us = (uint32_t) ((copy_start - start) / tsc_per_us);
+    stats.frames++;
+    stats.last_wait_us = wait_us;
+    stats.total_wait_us += wait_us;
+    if(wait_us > stats.max_wait_us)
+        stats.max_wait_us = wait_us;
+    stats.last_copy_us = (uint32_t) ((read_tsc() - copy_start) / tsc_per_us);
+}
+
+int vg_set_palette(uint8_t first, uint16_t count, const palette_color *colors){
+
+    int res;
+    if((res = palette_set_entries(first, count, colors)) != OK)
+        return res;
+
+    /* Direct color modes only use the palette to expand indexed buffers */
+    if(get_memory_model() != INDEXED_COLOR_MODE)
+        return VBE_OK;
+
+    /* The DAC takes 6 bits per component */
+    for(uint16_t i = 0; i < count; i++){
+        dac_entries[4 * i] = colors[i].blue >> (BYTE_SIZE - DAC_COMPONENT_BITS);
+        dac_entries[4 * i + 1] = colors[i].green >> (BYTE_SIZE - DAC_COMPONENT_BITS);
+        dac_entries[4 * i + 2] = colors[i].red >> (BYTE_SIZE - DAC_COMPONENT_BITS);
+        dac_entries[4 * i + 3] = 0;
+    }
+
+    uint8_t subfunction = (present_sync_mode == PRESENT_SYNC_RETRACE ? SET_PALETTE_RETRACE : SET_PALETTE);
+
+    if(pm_set_palette != NULL){
+        if(call_pm(pm_set_palette, (VBE_FUNC << 8) | SET_GET_PALETTE, subfunction, count, first, dac_entries) != FUNC_RETURN_OK){
+            printf("(%s): protected mode call failed\n", __func__);
+            return VBE_INVALID_RETURN;
+        }
+        return VBE_OK;
+    }
+
+    struct reg86u r;
+    mmap_t mmap;
+
+    /* Reset the struct values */
+    memset(&r, 0, sizeof(r));
+
+    /* The entries are passed in low memory */
+    if (retry_lm_alloc(count * 4, &mmap) == NULL) {
+        printf("(%s): lm_alloc() failed\n", __func__);
+        return VBE_LM_ALLOC_FAILED;
+    }
+    memcpy(mmap.virt, dac_entries, count * 4);
+
+    /* Build the struct */
+    r.u.b.ah = VBE_FUNC;
+    r.u.b.al = SET_GET_PALETTE;
+    r.u.b.bl = subfunction;
+    r.u.w.cx = count;
+    r.u.w.dx = first;
+    r.u.w.es = PB2BASE(mmap.phys);
+    r.u.w.di = PB2OFF(mmap.phys);
+    r.u.b.intno = VIDEO_CARD_SRV;
+
+    /* BIOS Call */
+    if( sys_int86(&r) != FUNC_SUCCESS || r.u.w.ax != FUNC_RETURN_OK ) {
+        lm_free(&mmap);
+        printf("(%s): couldnt set the palette\n", __func__);
+        return VBE_INVALID_RETURN;
+    }
+
+    /* Free allocated memory */
+    lm_free(&mmap);
+
+    return VBE_OK;
+}
+
+bool vg_has_pm_interface(){
+    return pm_table != NULL;
+}
+
+void vg_request_refresh_rate(uint16_t hz){
+    requested_refresh = hz;
+}
+
+uint32_t get_refresh_rate(){
+
+    if(refresh_rate != 0)
+        return refresh_rate;
+
+    /* Time a few frames from one retrace to another */
+    if(vg_wait_retrace() != VBE_OK)
+        return 0;
+    uint64_t start = read_tsc();
+    for(unsigned i = 0; i < REFRESH_MEASURE_FRAMES; i++)
+        if(vg_wait_retrace() != VBE_OK)
+            return 0;
+    uint64_t elapsed_us = (read_tsc() - start) / tsc_per_us;
+
+    if(elapsed_us != 0)
+        refresh_rate = (uint32_t) (REFRESH_MEASURE_FRAMES * 100000000ull / elapsed_us);
+    return refresh_rate;
+}
+
+void vg_set_present_sync(present_sync sync){
+    present_sync_mode = sync;
+}
+
+int vg_wait_retrace(){
+
+    uint64_t deadline = read_tsc() + (uint64_t) RETRACE_TIMEOUT_US * tsc_per_us;
+    uint32_t status;
+
+    /* A retrace already under way may be about to end, so wait for the next one to start */
+    do {
+        if(sys_inb(VGA_INPUT_STATUS_1, &status) != OK)
+            return VBE_NOT_OK;
+        if(read_tsc() > deadline)
+            return VBE_RETRACE_TIMEOUT;
+    } while(status & VGA_VRETRACE);
+
+    do {
+        if(sys_inb(VGA_INPUT_STATUS_1, &status) != OK)
+            return VBE_NOT_OK;
+        if(read_tsc() > deadline)
+            return VBE_RETRACE_TIMEOUT;
+    } while(!(status & VGA_VRETRACE));
+
+    return VBE_OK;
+}
+
+const present_stats *get_present_stats(){
+    return &stats;
+}
+
+void vg_reset_present_stats(){
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint32_t get_tsc_per_us(){
+    return tsc_per_us;
+}
+
+int vg_set_render_scale(uint8_t scale){
+
+    /* Only integer factors that evenly divide the screen are supported */
+    if((scale != 1 && scale != 2 && scale != 4) || get_x_res() % scale != 0 || get_y_res() % scale != 0){
+        printf("(%s) Invalid render scale: %d\n", __func__, scale);
+        return VBE_INVALID_SCALE;
+    }
+
+    if(scale > 1 && row_buffer == NULL){
+        printf("(%s) There is no row buffer to upscale into\n", __func__);
+        return VBE_NOT_OK;
+    }
+
+    render_scale = scale;
+    return VBE_OK;
+}
+
+int vg_set_buffer_format(buffer_format format){
+
+    if(format != BUFFER_NATIVE && format != BUFFER_INDEXED){
+        printf("(%s) Invalid buffer format: %d\n", __func__, format);
+        return VBE_INVALID_COLOR_MODE;
+    }
+
+    /* Indexed buffers in a direct color mode are expanded through the palette */
+    if(format == BUFFER_INDEXED && get_memory_model() == DIRECT_COLOR_MODE && expand_buffer == NULL){
+        printf("(%s) There is no row buffer to expand into\n", __func__);
+        return VBE_NOT_OK;
+    }
+
+    back_buffer_format = format;
+    palette_lut_version = palette_version() - 1;
+    return VBE_OK;
+}
+
+uint32_t rgb_to_color(uint8_t red, uint8_t green, uint8_t blue){
+
+    /* Indexed modes and buffers take the nearest palette entry */
+    if(get_memory_model() == INDEXED_COLOR_MODE || back_buffer_format == BUFFER_INDEXED)
+        return palette_nearest(red, green, blue);
+
+    return vg_pack_rgb(red, green, blue);
+}
+
+uint32_t vg_pack_rgb(uint8_t red, uint8_t green, uint8_t blue){
+
+    /* Keep the most significant bits of each component */
+    return ((uint32_t) (red >> (BYTE_SIZE - get_red_mask_size())) << get_red_field_position()) |
+           ((uint32_t) (green >> (BYTE_SIZE - get_green_mask_size())) << get_green_field_position()) |
+           ((uint32_t) (blue >> (BYTE_SIZE - get_blue_mask_size())) << get_blue_field_position());
+}
+
+void vg_set_present_compare(bool enable){
+    present_compare = enable;
+    shadow_valid = false;
+}
+
+void vg_set_present_copy(present_copy_strategy strategy){
+    if(strategy < PRESENT_COPY_COUNT)
+        present_strategy = strategy;
+}
+
+present_copy_strategy get_present_copy(){
+    return present_strategy;
+}
+
+size_t get_frame_size(){
+    return (size_t) get_x_res() * get_y_res() * calculate_size_in_bytes(get_bits_per_pixel());
+}
+
+size_t get_buffer_size(){
+    return (size_t) get_buffer_x_res() * get_buffer_y_res() * get_buffer_bytes_per_pixel();
+}
+
+uint8_t get_buffer_bytes_per_pixel(){
+    /* Indexed buffers use one byte per pixel whatever the mode */
+    if(back_buffer_format == BUFFER_INDEXED)
+        return 1;
+    return calculate_size_in_bytes(get_bits_per_pixel());
+}
+
+/*
+ * Sets the logical scanline length in pixels. On success r holds the BIOS' answer:
+ * BX bytes per scanline, CX pixels per scanline and DX maximum number of scanlines.
+ */
+static int set_logical_scanline(uint16_t width, struct reg86u *r){
+
+    /* Reset the struct values */
+    memset(r, 0, sizeof(*r));
+
+    /* Build the struct */
+    r->u.b.ah = VBE_FUNC;
+    r->u.b.al = SET_GET_LOGICAL_SCANLINE;
+    r->u.b.bl = SET_SCANLINE_LENGTH_PIXELS;
+    r->u.w.cx = width;
+    r->u.b.intno = VIDEO_CARD_SRV;
+
+    /* BIOS Call */
+    if(sys_int86(r) != FUNC_SUCCESS){
+        printf("(%s): sys_int86() failed \n", __func__);
+        return VBE_SYS_INT86_FAILED;
+    }
+
+    /* Verify the return for errors */
+    if(r->u.w.ax != FUNC_RETURN_OK){
+        printf("(%s): sys_int86() return in ax was different from OK \n", __func__);
+        return VBE_INVALID_RETURN;
+    }
+    return VBE_OK;
+}
+
+int vg_set_virtual_resolution(uint16_t width, uint16_t height){
+
+    if(width < get_x_res() || height < get_y_res()){
+        printf("(%s) The canvas can not be smaller than the screen\n", __func__);
+        return VBE_INVALID_VIRTUAL_RES;
+    }
+
+    struct reg86u r;
+    int res;
+    if((res = set_logical_scanline(width, &r)) != VBE_OK)
+        return res;
+
+    /* Drawing code assumes rows of whole pixels, and the canvas has to fit in the mapped memory */
+    uint8_t pixel_size = calculate_size_in_bytes(get_bits_per_pixel());
+    if(r.u.w.bx != (size_t) r.u.w.cx * pixel_size || height > r.u.w.dx || (size_t) r.u.w.bx * height > vram_mapped_size){
+        printf("(%s) A %dx%d canvas does not fit in VRAM\n", __func__, width, height);
+        set_logical_scanline(virtual_x_res, &r);
+        return VBE_INVALID_VIRTUAL_RES;
+    }
+
+    virtual_x_res = r.u.w.cx;
+    virtual_y_res = height;
+    update_screen_surface();
+
+    /* The old contents are now scrambled */
+    shadow_valid = false;
+    return vg_set_display_start(0, 0);
+}
+
+int vg_set_display_start(uint16_t x, uint16_t y){
+
+    /* The screen has to stay inside the canvas */
+    if(x > virtual_x_res - get_x_res() || y > virtual_y_res - get_y_res()){
+        printf("(%s) Invalid coordinates: x=%d, y=%d\n", __func__, x, y);
+        return VBE_INVALID_COORDS;
+    }
+
+    uint8_t subfunction = (present_sync_mode == PRESENT_SYNC_RETRACE ? SET_DISPLAY_START_RETRACE : SET_DISPLAY_START);
+
+    if(pm_set_display_start != NULL){
+        /* The protected mode entry takes the start address in 4 byte units, split over CX and DX */
+        uint32_t start = (uint32_t) (((size_t) y * virtual_x_res + x) * calculate_size_in_bytes(get_bits_per_pixel()) >> 2);
+        if(call_pm(pm_set_display_start, (VBE_FUNC << 8) | SET_GET_DISPLAY_START, subfunction, start & 0xFFFF, start >> 16, NULL) != FUNC_RETURN_OK){
+            printf("(%s): protected mode call failed\n", __func__);
+            return VBE_INVALID_RETURN;
+        }
+    }
+    else {
+        struct reg86u r;
+
+        /* Reset the struct values */
+        memset(&r, 0, sizeof(r));
+
+        /* Build the struct */
+        r.u.b.ah = VBE_FUNC;
+        r.u.b.al = SET_GET_DISPLAY_START;
+        r.u.b.bl = subfunction;
+        r.u.w.cx = x;
+        r.u.w.dx = y;
+        r.u.b.intno = VIDEO_CARD_SRV;
+
+        /* BIOS Call */
+        if(sys_int86(&r) != FUNC_SUCCESS){
+            printf("(%s): sys_int86() failed \n", __func__);
+            return VBE_SYS_INT86_FAILED;
+        }
+
+        /* Verify the return for errors */
+        if(r.u.w.ax != FUNC_RETURN_OK){
+            printf("(%s): sys_int86() return in ax was different from OK \n", __func__);
+            return VBE_INVALID_RETURN;
+        }
+    }
+
+    display_x = x;
+    display_y = y;
+
+    /* The shadow copy describes the window that was shown before */
+    shadow_valid = false;
+    return VBE_OK;
 }
 
 uint32_t get_pattern_color(uint32_t first, uint8_t row, uint8_t col, uint8_t step, uint8_t no_rectangles){
@@ -269,6 +1627,12 @@ int draw_pattern(uint16_t width, uint16_t height, uint8_t no_rectangles, uint32_
 uint8_t get_bits_per_pixel() { return vbe_mode_info.BitsPerPixel; }
 uint16_t get_x_res() { return vbe_mode_info.XResolution; }
 uint16_t get_y_res() { return vbe_mode_info.YResolution; }
+uint16_t get_buffer_x_res() { return vbe_mode_info.XResolution / render_scale; }
+uint16_t get_buffer_y_res() { return vbe_mode_info.YResolution / render_scale; }
+uint16_t get_virtual_x_res() { return virtual_x_res; }
+uint16_t get_virtual_y_res() { return virtual_y_res; }
+uint16_t get_display_x() { return display_x; }
+uint16_t get_display_y() { return display_y; }
 uint8_t get_memory_model() { return vbe_mode_info.MemoryModel; }
 uint8_t get_red_mask_size() { return vbe_mode_info.RedMaskSize; }
 uint8_t get_red_field_position() { return vbe_mode_info.RedFieldPosition; }
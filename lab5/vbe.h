@@ -1,6 +1,8 @@
 #ifndef VBE_H
 #define VBE_H
 
+#include "palette.h"
+
 #define BIT(n) (0x01<<(n))
 
 /* BIOS Services */
@@ -14,6 +16,32 @@
 #define RETURN_VBE_MODE_INFO 0x01
 #define SET_VBE_MODE 0x02
 #define RETURN_CURRENT_MODE_INFO 0x03
+#define SET_GET_LOGICAL_SCANLINE 0x06
+#define SET_GET_DISPLAY_START 0x07
+#define SET_GET_PALETTE 0x09
+#define RETURN_PM_INTERFACE 0x0A
+#define GET_SET_PIXEL_CLOCK 0x0B
+
+/* Subfunctions, passed in BL */
+#define SET_SCANLINE_LENGTH_PIXELS 0x00
+#define SET_DISPLAY_START 0x00
+#define SET_DISPLAY_START_RETRACE 0x80 /* Waits for the vertical retrace before changing it */
+#define GET_CLOSEST_PIXEL_CLOCK 0x00
+#define SET_PALETTE 0x00
+#define SET_PALETTE_RETRACE 0x80
+#define GET_PM_TABLE 0x00
+
+/* Protected mode interface table: offsets to the entry points and to the list of ports and memory used */
+#define PM_SET_DISPLAY_START 1
+#define PM_SET_PALETTE 2
+#define PM_PORTS_MEMORY 3
+#define PM_LIST_END 0xFFFF
+
+/* The protected mode interface needs VBE 2.0 */
+#define VBE_VERSION_2 0x0200
+
+/* TotalMemory is given in 64KB blocks */
+#define VBE_MEMORY_BLOCK_SIZE (64 * 1024)
 
 /* VBE function return in AH*/
 #define FUNC_SUCCESS 0x00
@@ -40,6 +68,43 @@
 
 /* Set VBE Mode */
 #define LINEAR_FRAME_BUFFER BIT(14)
+#define USE_CRTC_INFO BIT(11) /* ES:DI points to a CRTCInfoBlock with the timings to use */
+
+/* CRTCInfoBlock flags */
+#define CRTC_DOUBLE_SCAN BIT(0)
+#define CRTC_INTERLACED BIT(1)
+#define CRTC_HSYNC_NEGATIVE BIT(2)
+#define CRTC_VSYNC_NEGATIVE BIT(3)
+
+/* Custom timings need VBE 3.0 */
+#define VBE_VERSION_3 0x0300
+
+/*
+ * Generalized Timing Formula constants, times in nanoseconds and the duty cycle in thousandths of a percent
+ */
+#define GTF_MIN_VSYNC_BP_NS 550000 /* Minimum vertical sync plus back porch */
+#define GTF_VSYNC_LINES 3
+#define GTF_MIN_PORCH_LINES 1
+#define GTF_DUTY_C 30000 /* Blanking duty cycle is C - M * horizontal period */
+#define GTF_DUTY_M 300 /* Per microsecond */
+#define GTF_HSYNC_PERCENT 8
+#define GTF_CELL_GRANULARITY 8
+
+#define REFRESH_MEASURE_FRAMES 8 /* Retraces timed when the refresh rate is not known */
+
+/* Present */
+#define PRESENT_BLOCK_SIZE 64 /* Bytes compared at once against the shadow frame, one cache line */
+#define PRESENT_CALIBRATION_SIZE (1 << 20) /* Maximum bytes copied per calibration round */
+#define PRESENT_CALIBRATION_ROUNDS 3 /* Timed rounds per copy strategy */
+
+/* Blending */
+#define TRANSLUCENT_CHUNK 64 /* Pixels of solid color blended at once by draw_translucent_rectangle_on */
+
+/* Vertical retrace */
+#define VGA_INPUT_STATUS_1 0x3DA
+#define VGA_VRETRACE BIT(3) /* Set while the beam returns to the top of the screen */
+#define RETRACE_TIMEOUT_US 50000 /* Longest wait for a retrace, in case the adapter never reports one */
+#define TSC_CALIBRATION_US 10000 /* Time measured to convert time stamp counter cycles to microseconds */
 
 /* Memory Model */
 #define INDEXED_COLOR_MODE 0x04
@@ -60,6 +125,47 @@ typedef struct __attribute__((packed)) {
   uint8_t OemData[256];
 } VbeInfoBlock;
 
+typedef struct __attribute__((packed)) {
+  uint16_t HorizontalTotal;
+  uint16_t HorizontalSyncStart;
+  uint16_t HorizontalSyncEnd;
+  uint16_t VerticalTotal;
+  uint16_t VerticalSyncStart;
+  uint16_t VerticalSyncEnd;
+  uint8_t Flags;
+  uint32_t PixelClock; /* Hz */
+  uint16_t RefreshRate; /* 0.01 Hz */
+  uint8_t Reserved[40];
+} CRTCInfoBlock;
+
+/*
+ * Pixel format of the back buffers handed to swap_buffers
+ */
+typedef enum _buffer_format {
+    BUFFER_NATIVE = 0, /* Same format as the screen */
+    BUFFER_INDEXED /* One palette index per pixel, expanded to direct color on present */
+} buffer_format;
+
+/*
+ * Rectangle of pixels that can be drawn to: the mapped VRAM, a back buffer,
+ * an offscreen image or a view into part of any of them
+ */
+typedef struct {
+    uint16_t width; /* Size in pixels along the x axis */
+    uint16_t height; /* Size in pixels along the y axis */
+    size_t pitch; /* Bytes from the start of a row to the start of the next */
+    buffer_format format; /* Pixel format, native ones follow the current mode */
+    uint8_t pixel_size; /* Size in bytes of a pixel */
+    uint8_t *pixels; /* First pixel of the top row */
+} surface_t;
+
+/*
+ * Returns the address of the pixel at the given coordinates of a surface
+ */
+static inline uint8_t *surface_at(const surface_t *surface, int32_t x, int32_t y) {
+    return surface->pixels + (size_t) y * surface->pitch + (size_t) x * surface->pixel_size;
+}
+
 /**
  * @brief Sets the specified video mode
  * 
@@ -88,6 +194,8 @@ int vbe_get_mode_info_2(uint16_t mode, vbe_mode_info_t * vmi_p);
 /**
  * @brief Draws the pixmap with given dimensions starting from coordinates x and y
  * 
+ * Pixmaps hold one byte per pixel, a palette index, as returned by read_xpm
+ * 
  * @param pixmap Pixmap to draw
  * @param x Top left corner coordinate along the x axis
  * @param y Top left corner coordinate along the y axis
@@ -99,30 +207,425 @@ void draw_pixmap(const char * pixmap, uint16_t x, uint16_t y, int width, int hei
 /**
  * @brief Clears the specified buffer with the given color
  * 
- * @param buffer Buffer to clear
+ * Sets every byte to the color, see clear_surface for whole pixels
+ * 
+ * @param buffer Screen or back buffer to clear
  * @param color Color to clear with
  */
 void (clear_buffer)(uint8_t *buffer, uint8_t color);
 
 /**
- * @brief Draws a pixmap on the specified buffer at given coordinates
+ * @brief Draws a pixmap on the specified surface, clipped to it
  * 
- * @param pixmap Pixmap to draw
- * @param x Top left corner coordinate along the x axis
- * @param y Top left corner coordinate along the y axis
+ * Direct color surfaces get the palette's color for each index
+ * 
+ * @param pixmap Pixmap to draw, one byte palette index per pixel as returned by read_xpm
+ * @param x Top left corner coordinate along the x axis, may be off the surface
+ * @param y Top left corner coordinate along the y axis, may be off the surface
+ * @param width Size in pixels of the pixmap along the x axis
+ * @param height Size in pixels of the pixmap along the y axis
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_pixmap_on(const char *pixmap, int16_t x, int16_t y, int width, int height, surface_t *surface);
+
+/**
+ * @brief Fills consecutive pixels with a color
+ * 
+ * The span fill every horizontal line and filled shape is drawn with
+ * 
+ * @param dst First pixel to fill
+ * @param color Color in the target's pixel format
+ * @param count Number of pixels
+ * @param pixel_size Size in bytes of a pixel
+ */
+void fill_pixels(uint8_t *dst, uint32_t color, size_t count, uint8_t pixel_size);
+
+/**
+ * @brief Draws a horizontal span on the specified surface, clipped to it
+ * 
+ * @param surface Surface to draw to
+ * @param x Coordinate of the first pixel along the x axis, may be off the surface
+ * @param y Coordinate along the y axis, may be off the surface
+ * @param len Number of pixels
+ * @param color Color in the surface's pixel format
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int fill_span_on(surface_t *surface, int32_t x, int32_t y, int32_t len, uint32_t color);
+
+/* How drawn pixels are combined with the ones already on the target */
+typedef enum _raster_op {
+    ROP_COPY = 0, /* Replace */
+    ROP_XOR, /* Applying the same color twice restores the original pixels */
+    ROP_AND,
+    ROP_OR
+} raster_op;
+
+/**
+ * @brief Combines consecutive pixels with a color
+ * 
+ * @param dst First pixel to combine
+ * @param color Color in the target's pixel format
+ * @param count Number of pixels
+ * @param pixel_size Size in bytes of a pixel
+ * @param op Operation to apply
+ */
+void rop_pixels(uint8_t *dst, uint32_t color, size_t count, uint8_t pixel_size, raster_op op);
+
+/**
+ * @brief Combines a horizontal span of the specified surface with a color, clipped to it
+ * 
+ * @param surface Surface to draw to
+ * @param x Coordinate of the first pixel along the x axis, may be off the surface
+ * @param y Coordinate along the y axis, may be off the surface
+ * @param len Number of pixels
+ * @param color Color in the surface's pixel format
+ * @param op Operation to apply
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int rop_span_on(surface_t *surface, int32_t x, int32_t y, int32_t len, uint32_t color, raster_op op);
+
+/**
+ * @brief Combines a filled rectangle of the specified surface with a color, clipped to it
+ * 
+ * @param x Top left corner coordinate along the x axis, may be off the surface
+ * @param y Top left corner coordinate along the y axis, may be off the surface
+ * @param width Size in pixels of the rectangle along the x axis
+ * @param height Size in pixels of the rectangle along the y axis
+ * @param color Color in the surface's pixel format
+ * @param op Operation to apply
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_rectangle_rop_on(int16_t x, int16_t y, uint16_t width, uint16_t height, uint32_t color, raster_op op, surface_t *surface);
+
+/**
+ * @brief Combines the outline of a rectangle with a color, touching each pixel once
+ * 
+ * With ROP_XOR, drawing the same outline again erases it, which suits selection and rubber-band feedback
+ * 
+ * @param x Top left corner coordinate along the x axis, may be off the surface
+ * @param y Top left corner coordinate along the y axis, may be off the surface
+ * @param width Size in pixels of the rectangle along the x axis
+ * @param height Size in pixels of the rectangle along the y axis
+ * @param color Color in the surface's pixel format
+ * @param op Operation to apply
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_rectangle_outline_rop_on(int16_t x, int16_t y, uint16_t width, uint16_t height, uint32_t color, raster_op op, surface_t *surface);
+
+/**
+ * @brief Combines a pixmap with the specified surface, clipped to it
+ * 
+ * @param pixmap Pixmap to draw, in the surface's pixel format
+ * @param x Top left corner coordinate along the x axis, may be off the surface
+ * @param y Top left corner coordinate along the y axis, may be off the surface
  * @param width Size in pixels of the pixmap along the x axis
  * @param height Size in pixels of the pixmap along the y axis
- * @param buffer Buffer to draw to
+ * @param op Operation to apply
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_pixmap_rop_on(const char *pixmap, int16_t x, int16_t y, int width, int height, raster_op op, surface_t *surface);
+
+/**
+ * @brief Combines a horizontal line on the screen with a color
+ * 
+ * @param x Coordinate of the first pixel along the x axis
+ * @param y Coordinate along the y axis
+ * @param len Number of pixels
+ * @param color Color to combine with
+ * @param op Operation to apply
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int vg_draw_hline_rop(uint16_t x, uint16_t y, uint16_t len, uint32_t color, raster_op op);
+
+/**
+ * @brief Combines a filled rectangle on the screen with a color
+ * 
+ * @param x Top left corner coordinate along the x axis
+ * @param y Top left corner coordinate along the y axis
+ * @param width Size in pixels of the rectangle along the x axis
+ * @param height Size in pixels of the rectangle along the y axis
+ * @param color Color to combine with
+ * @param op Operation to apply
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int vg_draw_rectangle_rop(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint32_t color, raster_op op);
+
+/**
+ * @brief Notifies that pixels of a drawing target were changed outside of this module
+ * 
+ * Needed when the target lies in the mapped VRAM, so swap_buffers stops trusting its shadow copy
+ * 
+ * @param buffer Target that was drawn to
+ */
+void vg_target_modified(const uint8_t *buffer);
+
+/**
+ * @brief Returns the surface covering the whole mapped VRAM
+ * 
+ * Spans the virtual canvas, so it changes with vg_set_virtual_resolution
+ * 
+ * @return Pointer to the screen surface, valid until the next mode change
+ */
+surface_t *get_screen_surface();
+
+/**
+ * @brief Describes a legacy drawing target as a surface
+ * 
+ * @param surface Address of memory to be initialized
+ * @param buffer Mapped VRAM or a back buffer of get_buffer_size() bytes
+ */
+void surface_from_buffer(surface_t *surface, uint8_t *buffer);
+
+/**
+ * @brief Copies a rectangle of a surface to another position in the same surface
+ * 
+ * Source and destination may overlap in any direction. Parts that would
+ * be read or written off the surface are clipped away.
+ * 
+ * @param surface Surface to move pixels in
+ * @param src_x Source top left corner coordinate along the x axis
+ * @param src_y Source top left corner coordinate along the y axis
+ * @param width Size in pixels of the rectangle along the x axis
+ * @param height Size in pixels of the rectangle along the y axis
+ * @param dst_x Destination top left corner coordinate along the x axis
+ * @param dst_y Destination top left corner coordinate along the y axis
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int move_region_on(surface_t *surface, int16_t src_x, int16_t src_y, uint16_t width, uint16_t height, int16_t dst_x, int16_t dst_y);
+
+/**
+ * @brief Scrolls the contents of a rectangle of a surface
+ * 
+ * The strip exposed on the opposite side of the movement keeps its old
+ * pixels, and is left for the caller to redraw
+ * 
+ * @param surface Surface to scroll
+ * @param x Top left corner coordinate along the x axis
+ * @param y Top left corner coordinate along the y axis
+ * @param width Size in pixels of the rectangle along the x axis
+ * @param height Size in pixels of the rectangle along the y axis
+ * @param dx Pixels to move the contents by along the x axis, positive to the right
+ * @param dy Pixels to move the contents by along the y axis, positive downwards
+ * @return Return 0 upon success and non-zero otherwise
  */
-void draw_pixmap_on(const char *pixmap, uint16_t x, uint16_t y, int width, int height, uint8_t * buffer);
+int scroll_region_on(surface_t *surface, int16_t x, int16_t y, uint16_t width, uint16_t height, int16_t dx, int16_t dy);
+
+/**
+ * @brief Blends an ARGB image on the specified surface at given coordinates, using each pixel's alpha
+ * 
+ * Only available in direct color modes, on buffers in the native format
+ * 
+ * @param image Pixels to draw, alpha in the top 8 bits
+ * @param x Top left corner coordinate along the x axis
+ * @param y Top left corner coordinate along the y axis
+ * @param width Size in pixels of the image along the x axis
+ * @param height Size in pixels of the image along the y axis
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_argb_on(const uint32_t *image, uint16_t x, uint16_t y, int width, int height, surface_t *surface);
+
+/**
+ * @brief Blends an image in the mode's pixel format on the specified surface with a constant alpha
+ * 
+ * @param image Pixels to draw
+ * @param x Top left corner coordinate along the x axis
+ * @param y Top left corner coordinate along the y axis
+ * @param width Size in pixels of the image along the x axis
+ * @param height Size in pixels of the image along the y axis
+ * @param alpha Opacity of the image, from 0 to 255
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_translucent_on(const uint8_t *image, uint16_t x, uint16_t y, int width, int height, uint8_t alpha, surface_t *surface);
+
+/**
+ * @brief Blends a solid rectangle on the specified surface with a constant alpha
+ * 
+ * @param x Top left corner coordinate along the x axis
+ * @param y Top left corner coordinate along the y axis
+ * @param width Size in pixels along the x axis
+ * @param height Size in pixels along the y axis
+ * @param color Color of the rectangle, in the mode's pixel format
+ * @param alpha Opacity of the rectangle, from 0 to 255
+ * @param surface Surface to draw to
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int draw_translucent_rectangle_on(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint32_t color, uint8_t alpha, surface_t *surface);
 
 /**
  * @brief Swaps the mapped memory to the specified buffer
  * 
+ * Compares the buffer against a shadow copy of the last presented frame
+ * and only writes to VRAM the blocks that changed.
+ * Buffers rendered at a reduced resolution are upscaled on the way.
+ * 
  * @param buffer Buffer to swap with
  */
 void swap_buffers(uint8_t *buffer);
 
+/**
+ * @brief Sets the factor by which back buffers are smaller than the screen
+ * 
+ * Back buffers become get_buffer_x_res() x get_buffer_y_res() pixels and
+ * swap_buffers repeats each pixel scale times in both directions.
+ * Buffers must be reallocated with get_buffer_size() after changing it.
+ * 
+ * @param scale 1 for full resolution, 2 for half or 4 for a quarter
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int vg_set_render_scale(uint8_t scale);
+
+/**
+ * @brief Sets the pixel format of the back buffers
+ * 
+ * Indexed buffers keep XPM pixmaps usable in direct color modes and take
+ * a quarter of the memory of a 32 bit buffer. swap_buffers expands them
+ * through a lookup table built from the palette.
+ * Buffers must be reallocated with get_buffer_size() after changing it.
+ * 
+ * @param format Format of the back buffers
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int vg_set_buffer_format(buffer_format format);
+
+/**
+ * @brief Converts a true color to a color usable on the back buffers
+ * 
+ * Indexed modes and buffers get the nearest palette entry, found with a
+ * table lookup, direct color ones get the packed pixel
+ * 
+ * @param red Red component, 8 bits
+ * @param green Green component, 8 bits
+ * @param blue Blue component, 8 bits
+ * @return Palette index or packed direct color
+ */
+uint32_t rgb_to_color(uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * @brief Packs a color in the pixel format of the current direct color mode
+ * 
+ * @param red Red component, 8 bits
+ * @param green Green component, 8 bits
+ * @param blue Blue component, 8 bits
+ * @return The packed color
+ */
+uint32_t vg_pack_rgb(uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * @brief Enables or disables comparing against the last presented frame in swap_buffers
+ * 
+ * Scenes that change almost every pixel each frame present faster with it disabled
+ * 
+ * @param enable True to only write changed blocks, false to always copy the whole frame
+ */
+void vg_set_present_compare(bool enable);
+
+/*
+ * Ways of copying a back buffer to VRAM.
+ * vg_init times each of them on the mapped framebuffer and keeps the fastest.
+ */
+typedef enum _present_copy_strategy {
+    PRESENT_COPY_MEMCPY = 0, /* libc memcpy */
+    PRESENT_COPY_REP_MOVSD, /* rep movsd string move */
+    PRESENT_COPY_STREAM, /* SSE2 non-temporal stores */
+    PRESENT_COPY_ROWS, /* One scanline at a time */
+
+    PRESENT_COPY_COUNT
+} present_copy_strategy;
+
+/**
+ * @brief Overrides the copy strategy chosen by the calibration in vg_init
+ * 
+ * @param strategy Strategy to use in swap_buffers
+ */
+void vg_set_present_copy(present_copy_strategy strategy);
+
+/**
+ * @brief Returns the copy strategy used in swap_buffers
+ * 
+ * @return Current copy strategy
+ */
+present_copy_strategy get_present_copy();
+
+/*
+ * When swap_buffers writes to VRAM
+ */
+typedef enum _present_sync {
+    PRESENT_SYNC_NONE = 0, /* Immediately, may tear */
+    PRESENT_SYNC_RETRACE /* At the start of the next vertical retrace */
+} present_sync;
+
+/* Time spent by swap_buffers, in microseconds */
+typedef struct {
+    uint32_t frames; /* Presents since the last reset */
+    uint32_t timeouts; /* Presents that gave up waiting for a retrace */
+    uint32_t last_wait_us; /* Waiting for the retrace in the last present */
+    uint32_t max_wait_us;
+    uint64_t total_wait_us;
+    uint32_t last_copy_us; /* Writing to VRAM in the last present */
+} present_stats;
+
+/**
+ * @brief Sets whether swap_buffers waits for the vertical retrace
+ * 
+ * Waiting also makes vg_set_display_start change the display start during the retrace
+ * 
+ * @param sync When to present
+ */
+void vg_set_present_sync(present_sync sync);
+
+/**
+ * @brief Waits for the start of the next vertical retrace, polling the VGA input status register
+ * 
+ * @return Return 0 upon success and non-zero otherwise, if no retrace was seen in RETRACE_TIMEOUT_US
+ */
+int vg_wait_retrace();
+
+/**
+ * @brief Returns the timing of the presents since the last reset
+ * 
+ * @return Present statistics
+ */
+const present_stats *get_present_stats();
+
+/**
+ * @brief Clears the present statistics
+ */
+void vg_reset_present_stats();
+
+/**
+ * @brief Returns the time stamp counter frequency measured in vg_init
+ * 
+ * @return Cycles per microsecond
+ */
+uint32_t get_tsc_per_us();
+
+/**
+ * @brief Returns the size in bytes of a full frame in the current mode
+ * 
+ * @return Size in bytes of the frame
+ */
+size_t get_frame_size();
+
+/**
+ * @brief Returns the size in bytes of a back buffer at the current render scale and format
+ * 
+ * @return Size in bytes of a back buffer
+ */
+size_t get_buffer_size();
+
+/**
+ * @brief Returns the size in bytes of a back buffer pixel
+ * 
+ * @return 1 for indexed buffers, the mode's pixel size otherwise
+ */
+uint8_t get_buffer_bytes_per_pixel();
+
 /**
  * @brief Returns the color of specified position following a pre-determined pattern
  * 
@@ -155,10 +658,80 @@ int draw_pattern(uint16_t width, uint16_t height, uint8_t no_rectangles, uint32_
  */
 void *retry_lm_alloc(size_t size, mmap_t *mmap);
 
+/**
+ * @brief Changes palette entries and, in indexed modes, loads them into the DAC
+ * 
+ * Uses the VBE protected mode interface when the adapter provides one and
+ * function 09h through sys_int86 otherwise. With PRESENT_SYNC_RETRACE the
+ * DAC is written during the vertical retrace.
+ * 
+ * @param first Index of the first entry to change
+ * @param count Number of entries to change
+ * @param colors New colors of the entries
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int vg_set_palette(uint8_t first, uint16_t count, const palette_color *colors);
+
+/**
+ * @brief Returns whether display start and palette changes skip sys_int86
+ * 
+ * @return True if the VBE protected mode interface is in use
+ */
+bool vg_has_pm_interface();
+
+/**
+ * @brief Requests a refresh rate for the modes set by the following calls to vg_init
+ * 
+ * Needs VBE 3.0. Timings are computed with the Generalized Timing Formula and
+ * the pixel clock is adjusted to the closest one the adapter can generate.
+ * If the adapter refuses them the mode is set with the BIOS default timings.
+ * 
+ * @param hz Refresh rate in Hz, 0 for the BIOS default
+ */
+void vg_request_refresh_rate(uint16_t hz);
+
+/**
+ * @brief Returns the refresh rate of the current mode
+ * 
+ * Known exactly when custom timings were set, otherwise measured once by timing vertical retraces
+ * 
+ * @return Refresh rate in hundredths of Hz, or 0 if it could not be determined
+ */
+uint32_t get_refresh_rate();
+
+/**
+ * @brief Makes VRAM a virtual canvas larger than the screen, which shows a window of it
+ * 
+ * Uses VBE function 06h to set the logical scanline length. The canvas must fit in
+ * the adapter's memory. Drawing to the mapped VRAM then uses the canvas dimensions,
+ * and swap_buffers presents to the window at the current display start.
+ * The BIOS may widen the canvas, see get_virtual_x_res().
+ * 
+ * @param width Canvas size in pixels along the x axis, at least the screen's
+ * @param height Canvas size in pixels along the y axis, at least the screen's
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int vg_set_virtual_resolution(uint16_t width, uint16_t height);
+
+/**
+ * @brief Pans the screen over the virtual canvas, using VBE function 07h
+ * 
+ * @param x Canvas coordinate along the x axis shown at the left of the screen
+ * @param y Canvas coordinate along the y axis shown at the top of the screen
+ * @return Return 0 upon success and non-zero otherwise
+ */
+int vg_set_display_start(uint16_t x, uint16_t y);
+
 /* Methods to return information from the vbe_mode_info_t struct */
 uint8_t get_bits_per_pixel();
 uint16_t get_x_res();
 uint16_t get_y_res();
+uint16_t get_buffer_x_res();
+uint16_t get_buffer_y_res();
+uint16_t get_virtual_x_res();
+uint16_t get_virtual_y_res();
+uint16_t get_display_x();
+uint16_t get_display_y();
 uint8_t get_memory_model();
 uint8_t get_red_mask_size();
 uint8_t get_red_field_position();
@@ -185,7 +758,11 @@ typedef enum _vbe_status {
 	VBE_OUT_OF_BOUNDS,
 
 	VBE_INVALID_COLOR_MODE,
-	VBE_DRAW_LINE_FAILED
+	VBE_DRAW_LINE_FAILED,
+
+	VBE_INVALID_SCALE,
+	VBE_INVALID_VIRTUAL_RES,
+	VBE_RETRACE_TIMEOUT
 
 
 } vbe_status;